@@ -0,0 +1,76 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_CANCELLATIONTOKEN_H
+#define M6SS_CANCELLATIONTOKEN_H
+
+#include <atomic>
+#include <stdexcept>
+
+namespace M6SS {
+
+    /**
+     * The exception that is thrown by an operation that is stopped through a CancellationToken.
+     */
+    class OperationCancelled : public std::runtime_error {
+    public:
+        OperationCancelled() : std::runtime_error("The operation was cancelled.") {}
+    };
+
+    /**
+     * This class represents a request to stop one or more operations that run in other threads (e.g., the simulations
+     * and the calculations of a validation, once a case has failed). The operations poll the token at regular
+     * intervals and throw OperationCancelled as soon as it is cancelled.
+     */
+    class CancellationToken {
+    public:
+        CancellationToken() = default;
+
+        CancellationToken(const CancellationToken &) = delete;
+
+        CancellationToken &operator=(const CancellationToken &) = delete;
+
+        /**
+         * Requests the cancellation of the operations that poll the token; it may be called by any thread.
+         */
+        void cancel() {
+            cancelled_.store(true, std::memory_order_relaxed);
+        }
+
+        /**
+         * Returns true if the cancellation has been requested.
+         */
+        [[nodiscard]] bool isCancelled() const {
+            return cancelled_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Throws OperationCancelled if the cancellation has been requested.
+         * @throw OperationCancelled if the cancellation has been requested.
+         */
+        void throwIfCancelled() const {
+            if (isCancelled()) {
+                throw OperationCancelled();
+            }
+        }
+
+    private:
+        std::atomic<bool> cancelled_{false};
+    };
+
+}
+
+#endif //M6SS_CANCELLATIONTOKEN_H
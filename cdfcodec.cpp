@@ -0,0 +1,171 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "cdfcodec.h"
+
+namespace {
+    void writeVarint(std::vector<unsigned char> &blob, std::uint64_t value) {
+        while (value >= 0x80) {
+            blob.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        blob.push_back(static_cast<unsigned char>(value));
+    }
+
+    std::uint64_t zigzag(std::int64_t value) {
+        return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+    }
+
+    std::int64_t unzigzag(std::uint64_t value) {
+        return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+}
+
+std::vector<unsigned char> M6SS::CDFCodec::encode(const std::vector<double> &cdf, Encoding encoding) {
+    std::vector<unsigned char> blob;
+    blob.push_back(static_cast<unsigned char>(encoding));
+
+    if (encoding == Encoding::Float) {
+        size_t K = cdf.size();
+        while (K > 0 and cdf[K - 1] >= 1) {
+            K--;
+        }
+        writeVarint(blob, K);
+
+        double previous = 0;
+        for (size_t k = 0; k < K; k++) {
+            float difference = static_cast<float>(cdf[k] - previous);
+            std::uint32_t bits;
+            std::memcpy(&bits, &difference, sizeof(bits));
+            for (int byte = 0; byte < 4; byte++) {
+                blob.push_back(static_cast<unsigned char>(bits >> (8 * byte)));
+            }
+            previous = cdf[k];
+        }
+        return blob;
+    }
+
+    std::vector<std::int64_t> quantized(cdf.size());
+    for (size_t k = 0; k < cdf.size(); k++) {
+        quantized[k] = std::llround(std::min(std::max(cdf[k], 0.0), 1.0) * QUANTIZED_ONE);
+    }
+    size_t K = quantized.size();
+    while (K > 0 and quantized[K - 1] == static_cast<std::int64_t>(QUANTIZED_ONE)) {
+        K--;
+    }
+    writeVarint(blob, K);
+
+    std::int64_t previous = 0;
+    for (size_t k = 0; k < K;) {
+        const std::int64_t difference = quantized[k] - previous;
+        writeVarint(blob, zigzag(difference));
+        if (difference != 0) {
+            previous = quantized[k++];
+            continue;
+        }
+
+        size_t run = 1;
+        while (k + run < K and quantized[k + run] == previous) {
+            run++;
+        }
+        writeVarint(blob, run);
+        k += run;
+    }
+    return blob;
+}
+
+std::vector<double> M6SS::CDFCodec::decode(const unsigned char *data, size_t size) {
+    Reader reader(data, size);
+    std::vector<double> cdf;
+    cdf.reserve(reader.size());
+    double value;
+    while (reader.next(value)) {
+        cdf.push_back(value);
+    }
+    return cdf;
+}
+
+M6SS::CDFCodec::Reader::Reader(const unsigned char *data, size_t size) : position_(data), end_(data + size) {
+    if (size == 0 or data[0] > static_cast<unsigned char>(Encoding::Quantized)) {
+        throw std::invalid_argument("The blob is not an encoded cdf.");
+    }
+    encoding_ = static_cast<Encoding>(*position_++);
+    size_ = remaining_ = readVarint();
+}
+
+size_t M6SS::CDFCodec::Reader::size() const {
+    return size_;
+}
+
+M6SS::CDFCodec::Encoding M6SS::CDFCodec::Reader::encoding() const {
+    return encoding_;
+}
+
+bool M6SS::CDFCodec::Reader::next(double &value) {
+    if (remaining_ == 0) {
+        return false;
+    }
+    remaining_--;
+
+    if (encoding_ == Encoding::Float) {
+        if (end_ - position_ < 4) {
+            throw std::invalid_argument("The blob ends before its values.");
+        }
+        std::uint32_t bits = 0;
+        for (int byte = 0; byte < 4; byte++) {
+            bits |= static_cast<std::uint32_t>(*position_++) << (8 * byte);
+        }
+        float difference;
+        std::memcpy(&difference, &bits, sizeof(difference));
+        value = value_ += difference;
+        return true;
+    }
+
+    if (zeroRun_ == 0) {
+        const std::int64_t difference = unzigzag(readVarint());
+        if (difference == 0) {
+            zeroRun_ = readVarint();
+            if (zeroRun_ == 0) {
+                throw std::invalid_argument("The blob contains an empty run.");
+            }
+        }
+        quantizedValue_ += difference;
+    }
+    if (zeroRun_ > 0) {
+        zeroRun_--;
+    }
+    value = static_cast<double>(quantizedValue_) / QUANTIZED_ONE;
+    return true;
+}
+
+std::uint64_t M6SS::CDFCodec::Reader::readVarint() {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position_ == end_) {
+            throw std::invalid_argument("The blob ends before its values.");
+        }
+        const unsigned char byte = *position_++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::invalid_argument("The blob contains an invalid varint.");
+}
@@ -0,0 +1,119 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_CDFCODEC_H
+#define M6SS_CDFCODEC_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace M6SS {
+
+    /**
+     * This class encodes the cdf of the number of steps for the synchronization, i.e., the values cdf(k) for
+     * k = 1, ..., K, where cdf(k) is one for k > K, as a compact binary blob (e.g., to store the curves of the model
+     * and the simulator in a database), and decodes such a blob in place.
+     *
+     * The values are delta-encoded, i.e., each value is stored as its difference from the previous one (with
+     * cdf(0) = 0), which is the probability of the step and is usually small. A blob starts with the encoding (a byte)
+     * and the number K of the values (a varint), which are followed by:
+     * - Float: the difference of each value as a little-endian IEEE 754 single-precision float (4 bytes per step).
+     * - Quantized: the values are quantized to multiples of 1 / QUANTIZED_ONE, and the difference of each quantized
+     *   value is stored as a zigzag varint. A zero difference is followed by the number of the consecutive zero
+     *   differences (a varint), so the steps where the cdf does not change (e.g., the steps of a scan period where no
+     *   enhanced beacon can be received) cost almost nothing.
+     * The values after the last value that is lower than one (after the quantization) are not stored.
+     */
+    class CDFCodec {
+    public:
+        enum class Encoding : std::uint8_t {
+            Float = 0, Quantized = 1
+        };
+
+        /* the quantized values are the multiples of 1 / QUANTIZED_ONE, which is about the resolution of the cdf of a
+         * simulation of 1000000 samples */
+        static constexpr double QUANTIZED_ONE = 1 << 20;
+
+        /* an upper bound of the absolute error of a value of the Quantized encoding */
+        static constexpr double QUANTIZATION_ERROR = 0.5 / QUANTIZED_ONE;
+
+        /**
+         * Encodes a cdf.
+         * @param cdf the values cdf(k) for k = 1, ..., K.
+         * @param encoding the encoding of the values.
+         * @return the blob of the cdf.
+         */
+        static std::vector<unsigned char> encode(const std::vector<double> &cdf, Encoding encoding);
+
+        /**
+         * Decodes all the values of a blob (see Reader).
+         * @param data the blob.
+         * @param size the size of the blob in bytes.
+         * @return the values cdf(k) for k = 1, ..., K.
+         * @throw std::invalid_argument if the blob is not valid.
+         */
+        static std::vector<double> decode(const unsigned char *data, size_t size);
+
+        /**
+         * A reader of the values of a blob, one at a time, that neither copies the blob nor allocates memory, so it
+         * can decode a blob where it is (e.g., the result of sqlite3_column_blob). The blob must outlive the reader.
+         */
+        class Reader {
+        public:
+            /**
+             * Reads the header of a blob.
+             * @param data the blob.
+             * @param size the size of the blob in bytes.
+             * @throw std::invalid_argument if the header of the blob is not valid.
+             */
+            Reader(const unsigned char *data, size_t size);
+
+            /**
+             * Returns the number K of the values of the blob.
+             */
+            [[nodiscard]] size_t size() const;
+
+            /**
+             * Returns the encoding of the blob.
+             */
+            [[nodiscard]] Encoding encoding() const;
+
+            /**
+             * Decodes the next value, i.e., cdf(k) for k = 1, ..., K.
+             * @param value on return, the value, if any.
+             * @return false if all the values have been read.
+             * @throw std::invalid_argument if the blob ends before its values.
+             */
+            bool next(double &value);
+
+        private:
+            std::uint64_t readVarint();
+
+            const unsigned char *position_;
+            const unsigned char *end_;
+            Encoding encoding_;
+            size_t size_;
+            size_t remaining_; // the number of the values that have not been read
+            double value_ = 0; // the last value of the Float encoding
+            std::int64_t quantizedValue_ = 0; // the last value of the Quantized encoding
+            std::uint64_t zeroRun_ = 0; // the number of the remaining zero differences of a run
+        };
+    };
+
+}
+
+#endif //M6SS_CDFCODEC_H
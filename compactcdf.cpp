@@ -0,0 +1,109 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+#include "compactcdf.h"
+
+M6SS::CompactCDF::CompactCDF() : head_(1, 0), size_(1), period_(0), rho_(0), error_(0) {}
+
+M6SS::CompactCDF::CompactCDF(std::vector<double> cdf, double maxError, size_t period)
+        : size_(cdf.size()), period_(0), rho_(0), error_(0) {
+    if (cdf.empty()) {
+        throw std::invalid_argument("cdf must contain at least cdf(0).");
+    }
+
+    if (maxError < 0) {
+        throw std::invalid_argument("maxError must not be negative.");
+    }
+
+    const size_t K = cdf.size() - 1; // the last step
+    const size_t P = period;
+    auto S = [&cdf](size_t k) { return 1 - cdf[k]; };
+
+    // Try heads of 2P, 4P, 8P, ... steps, and keep the first whose tail reproduces all the following steps. The ratio
+    // of the tail is that of the last two periods of the head.
+    for (size_t H = 2 * P; P > 0 and maxError > 0 and H + P <= K; H *= 2) {
+        if (S(H - P) <= 0) {
+            break;
+        }
+        const double rho = S(H) / S(H - P);
+        if (not(rho >= 0 and rho < 1)) {
+            continue;
+        }
+
+        double error = 0;
+        size_t m = 1;
+        for (size_t first = H + 1; first <= K and error <= maxError; first += P, m++) {
+            const double factor = std::pow(rho, double(m)); // the same as in operator[] for the steps of the block
+            for (size_t k = first; k < first + P and k <= K; k++) {
+                error = std::max(error, std::abs(S(k - (first - H - 1) - P) * factor - S(k)));
+            }
+        }
+
+        if (error <= maxError) {
+            cdf.resize(H + 1);
+            period_ = P;
+            rho_ = rho;
+            error_ = error;
+            break;
+        }
+    }
+
+    head_ = std::move(cdf);
+    head_.shrink_to_fit();
+}
+
+double M6SS::CompactCDF::operator[](size_t k) const {
+    if (k >= size_) {
+        return 1;
+    }
+
+    const size_t H = head_.size() - 1;
+    if (k <= H) {
+        return head_[k];
+    }
+
+    // the step k corresponds to the step k - m * P of the last period of the head, with m = ceil((k - H) / P)
+    const size_t m = (k - H + period_ - 1) / period_;
+    return 1 - (1 - head_[k - m * period_]) * std::pow(rho_, double(m));
+}
+
+size_t M6SS::CompactCDF::size() const {
+    return size_;
+}
+
+size_t M6SS::CompactCDF::quantile(double p) const {
+    size_t low = 1, high = size_; // cdf(high) is one
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if ((*this)[middle] < p) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+double M6SS::CompactCDF::error() const {
+    return error_;
+}
+
+size_t M6SS::CompactCDF::storedSize() const {
+    return head_.size();
+}
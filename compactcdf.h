@@ -0,0 +1,89 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_COMPACTCDF_H
+#define M6SS_COMPACTCDF_H
+
+#include <vector>
+#include <cstddef>
+
+namespace M6SS {
+
+    /**
+     * This class represents the cdf of the number of steps for the synchronization in a compact form: an exact head of
+     * the first steps, followed by a periodic geometric tail, where the survival function 1 - cdf(k) decreases by a
+     * constant factor every P steps, i.e., 1 - cdf(k + P) = rho * (1 - cdf(k)). This is the form of the tail of the
+     * model in Cases 1 and 2, where each lane of the calculation (see PsyncKernel) repeats its channels every n * C
+     * steps, so after the lane with the slowest decay dominates, only the head needs to be kept, whatever the number of
+     * the steps. The values of the tail are produced on demand.
+     *
+     * The tail is used only if it reproduces every value of the original cdf within a given absolute error, otherwise
+     * the whole cdf is kept as the head. As in a dense array, cdf(0) is zero and cdf(k) is one for k ≥ size().
+     */
+    class CompactCDF {
+    public:
+        /**
+         * Initializes an empty cdf, i.e., one for all the steps.
+         */
+        CompactCDF();
+
+        /**
+         * Initializes a compact cdf from a dense one.
+         * @param cdf the values cdf(k) for k = 0, 1, ..., where cdf(0) is zero.
+         * @param maxError the maximum absolute error of the values of the tail; if zero, the cdf is kept dense.
+         * @param period the period P of the tail, in steps (e.g., n * C in Case 2); if zero, the cdf is kept dense.
+         * @throw std::invalid_argument if cdf is empty or maxError is negative.
+         */
+        CompactCDF(std::vector<double> cdf, double maxError, size_t period);
+
+        /**
+         * Returns cdf(k), which is zero for k = 0 and one for k ≥ size().
+         */
+        double operator[](size_t k) const;
+
+        /**
+         * Returns the number of the represented values (including k = 0), i.e., the first k for which cdf(k) is one
+         * by definition.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Returns the minimum k ≥ 1 for which cdf(k) ≥ p, through a binary search.
+         */
+        [[nodiscard]] size_t quantile(double p) const;
+
+        /**
+         * Returns the maximum absolute error of the values of the tail against the original cdf (zero if there is no
+         * tail).
+         */
+        [[nodiscard]] double error() const;
+
+        /**
+         * Returns the number of the values that are stored (i.e., the size of the head).
+         */
+        [[nodiscard]] size_t storedSize() const;
+
+    private:
+        std::vector<double> head_; // cdf(k) for k = 0, ..., H
+        size_t size_;
+        size_t period_; // zero if there is no tail
+        double rho_;
+        double error_;
+    };
+
+}
+
+#endif //M6SS_COMPACTCDF_H
@@ -0,0 +1,57 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_COMPENSATEDSUM_H
+#define M6SS_COMPENSATEDSUM_H
+
+#include <cmath>
+
+namespace M6SS {
+
+    /**
+     * This class implements the compensated (Kahan-Babuska-Neumaier) summation, which keeps the rounding error of a
+     * long sum of floating point numbers independent of the number of the terms.
+     */
+    template<class Real>
+    class NeumaierSum {
+    public:
+        NeumaierSum &operator+=(Real x) {
+            using std::abs;
+            Real t = sum_ + x;
+            if (abs(sum_) >= abs(x)) {
+                compensation_ += (sum_ - t) + x;
+            } else {
+                compensation_ += (x - t) + sum_;
+            }
+            sum_ = t;
+            return *this;
+        }
+
+        /**
+         * Returns the compensated sum of the terms added so far.
+         */
+        [[nodiscard]] Real value() const {
+            return sum_ + compensation_;
+        }
+
+    private:
+        Real sum_ = 0;
+        Real compensation_ = 0;
+    };
+
+}
+
+#endif //M6SS_COMPENSATEDSUM_H
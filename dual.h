@@ -0,0 +1,193 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_DUAL_H
+#define M6SS_DUAL_H
+
+#include <cmath>
+
+namespace M6SS {
+
+    /**
+     * This class represents a (multivariate) dual number, i.e., a value together with its partial derivatives with
+     * respect to N independent variables, for forward-mode automatic differentiation. The arithmetic operators
+     * propagate the derivatives through the chain rule, while the comparisons consider only the values. The model uses
+     * it for the derivatives with respect to Peb and the Psr of each channel (see Model::Sensitivities), with the
+     * smallest N that fits the number of channels, since the cost of each operation grows linearly with N.
+     */
+    template<int N>
+    class Dual {
+    public:
+        static constexpr int MAX_VARIABLES = N;
+
+        Dual(double value = 0) : value_(value), derivatives_{} {} // a constant, i.e., with zero derivatives
+
+        /**
+         * Returns an independent variable, i.e., a dual number whose derivative with respect to itself is one.
+         * @param value the value of the variable.
+         * @param index the index of the variable, in the range [0, N).
+         */
+        static Dual variable(double value, int index) {
+            Dual x(value);
+            x.derivatives_[index] = 1;
+            return x;
+        }
+
+        [[nodiscard]] double value() const { return value_; }
+
+        /**
+         * Returns the partial derivative with respect to the variable with the given index.
+         */
+        [[nodiscard]] double derivative(int index) const { return derivatives_[index]; }
+
+        explicit operator double() const { return value_; }
+
+        Dual &operator+=(const Dual &x) {
+            value_ += x.value_;
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                derivatives_[i] += x.derivatives_[i];
+            }
+            return *this;
+        }
+
+        Dual &operator-=(const Dual &x) {
+            value_ -= x.value_;
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                derivatives_[i] -= x.derivatives_[i];
+            }
+            return *this;
+        }
+
+        Dual &operator*=(const Dual &x) {
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                derivatives_[i] = derivatives_[i] * x.value_ + value_ * x.derivatives_[i];
+            }
+            value_ *= x.value_;
+            return *this;
+        }
+
+        Dual &operator*=(double x) {
+            value_ *= x;
+            for (double &derivative: derivatives_) {
+                derivative *= x;
+            }
+            return *this;
+        }
+
+        Dual &operator/=(const Dual &x) {
+            value_ /= x.value_;
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                derivatives_[i] = (derivatives_[i] - value_ * x.derivatives_[i]) / x.value_;
+            }
+            return *this;
+        }
+
+        Dual &operator/=(double x) {
+            value_ /= x;
+            for (double &derivative: derivatives_) {
+                derivative /= x;
+            }
+            return *this;
+        }
+
+        friend Dual operator-(const Dual &x) { return x * -1.0; }
+
+        friend Dual operator+(const Dual &x, const Dual &y) {
+            Dual result(x.value_ + y.value_, Uninitialized());
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                result.derivatives_[i] = x.derivatives_[i] + y.derivatives_[i];
+            }
+            return result;
+        }
+
+        friend Dual operator-(const Dual &x, const Dual &y) {
+            Dual result(x.value_ - y.value_, Uninitialized());
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                result.derivatives_[i] = x.derivatives_[i] - y.derivatives_[i];
+            }
+            return result;
+        }
+
+        friend Dual operator*(const Dual &x, const Dual &y) {
+            Dual result(x.value_ * y.value_, Uninitialized());
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                result.derivatives_[i] = x.derivatives_[i] * y.value_ + x.value_ * y.derivatives_[i];
+            }
+            return result;
+        }
+
+        friend Dual operator*(const Dual &x, double y) {
+            Dual result(x.value_ * y, Uninitialized());
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                result.derivatives_[i] = x.derivatives_[i] * y;
+            }
+            return result;
+        }
+
+        friend Dual operator*(double x, const Dual &y) { return y * x; }
+
+        friend Dual operator/(const Dual &x, const Dual &y) {
+            Dual result(x.value_ / y.value_, Uninitialized());
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                result.derivatives_[i] = (x.derivatives_[i] - result.value_ * y.derivatives_[i]) / y.value_;
+            }
+            return result;
+        }
+
+        friend Dual operator/(const Dual &x, double y) {
+            Dual result(x.value_ / y, Uninitialized());
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                result.derivatives_[i] = x.derivatives_[i] / y;
+            }
+            return result;
+        }
+
+        friend bool operator<(const Dual &x, const Dual &y) { return x.value_ < y.value_; }
+
+        friend bool operator>(const Dual &x, const Dual &y) { return x.value_ > y.value_; }
+
+        friend bool operator<=(const Dual &x, const Dual &y) { return x.value_ <= y.value_; }
+
+        friend bool operator>=(const Dual &x, const Dual &y) { return x.value_ >= y.value_; }
+
+        friend Dual abs(const Dual &x) { return x.value_ < 0 ? -x : x; }
+
+        /**
+         * Returns x raised to a constant power.
+         */
+        friend Dual pow(const Dual &x, double exponent) {
+            Dual result(std::pow(x.value_, exponent), Uninitialized());
+            // d(x^e) = e * x^(e - 1) * dx, which is zero for e = 0 (even if x = 0)
+            const double factor = exponent == 0 ? 0 : exponent * std::pow(x.value_, exponent - 1);
+            for (int i = 0; i < MAX_VARIABLES; i++) {
+                result.derivatives_[i] = factor * x.derivatives_[i];
+            }
+            return result;
+        }
+
+    private:
+        struct Uninitialized {
+        };
+
+        Dual(double value, Uninitialized) : value_(value) {} // the derivatives are assigned by the caller
+
+        double value_;
+        double derivatives_[MAX_VARIABLES];
+    };
+
+}
+
+#endif //M6SS_DUAL_H
@@ -0,0 +1,140 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <algorithm>
+#include "modelcache.h"
+#include "inversesolver.h"
+
+using std::chrono::duration;
+
+M6SS::InverseSolver::Result M6SS::InverseSolver::solve(const SyncParameters &syncParams, Variable variable,
+                                                       duration<double> target, const Options &options,
+                                                       ModelCache &cache) {
+    if (target <= duration<double>::zero()) {
+        throw std::invalid_argument("target must be greater than zero.");
+    }
+
+    if (options.percentile < 0 or options.percentile >= 1) {
+        throw std::invalid_argument("percentile must be in the range [0, 1).");
+    }
+
+    if (options.tolerance <= 0) {
+        throw std::invalid_argument("tolerance must be greater than zero.");
+    }
+
+    if (options.maxEvaluations < 1) {
+        throw std::invalid_argument("maxEvaluations must be greater than zero.");
+    }
+
+    double maxValue = 1;
+    if (variable == Variable::PsrScale) {
+        double maxPsr = 0;
+        for (const auto &entry: syncParams.getPsr()) {
+            maxPsr = std::max(maxPsr, entry.second);
+        }
+        if (maxPsr == 0) {
+            throw std::invalid_argument("The Psr values can not be scaled, since they are all zero.");
+        }
+        maxValue = 1 / maxPsr;
+    }
+
+    Result result{};
+    auto evaluate = [&](double value) { // returns the objective and the results for a value of the variable
+        double pEB = syncParams.getPeb();
+        std::map<int, double> pSR = syncParams.getPsr();
+        if (variable == Variable::Peb) {
+            pEB = value;
+        } else {
+            for (auto &entry: pSR) {
+                entry.second = std::min(1.0, entry.second * value);
+            }
+        }
+        SyncParameters candidate(syncParams.getCHS(), syncParams.getS(), pEB, pSR, syncParams.getTScan(),
+                                 syncParams.getTSwitch(), syncParams.getTeb());
+
+        std::shared_ptr<const Model::Results> results = cache.find(candidate);
+        if (!results) {
+            auto calculated = std::make_shared<Model::Results>();
+            Model::calculate(candidate, *calculated, cache.getOptions());
+            cache.put(candidate, calculated);
+            results = calculated;
+            result.numEvaluations++;
+        }
+
+        duration<double> objective = options.percentile > 0 ? results->quantileTime(options.percentile)
+                                                            : results->avgSyncTime();
+        return std::make_pair(objective, results);
+    };
+
+    // The bracket [low, high] of the solution, where the target is met at high but not at low, and the rates
+    // (i.e., 1 / objective) at its ends. The rate at zero is zero, since no synchronization is possible.
+    double low = 0, high = maxValue;
+    auto highEvaluation = evaluate(high);
+    double lowRate = 0, highRate = 1 / highEvaluation.first.count();
+    const double targetRate = 1 / target.count();
+
+    result.feasible = highEvaluation.first <= target;
+    if (result.feasible) {
+        auto narrow = [&](double value) {
+            auto evaluation = evaluate(value);
+            if (evaluation.first <= target) {
+                high = value;
+                highRate = 1 / evaluation.first.count();
+                highEvaluation = evaluation;
+                return true;
+            }
+            low = value;
+            lowRate = 1 / evaluation.first.count();
+            return false;
+        };
+
+        if (options.initialGuess > 0 and options.initialGuess < maxValue) {
+            narrow(options.initialGuess);
+        }
+
+        int numSlowSteps = 0; // the consecutive steps that did not halve the bracket
+        while (high - low > options.tolerance and result.numEvaluations < options.maxEvaluations) {
+            const double width = high - low;
+            double value;
+            if (numSlowSteps >= 2) { // bisection
+                value = (low + high) / 2;
+            } else { // regula falsi on the rate, kept at least tolerance / 2 inside the bracket
+                value = low + (targetRate - lowRate) * width / (highRate - lowRate);
+                value = std::min(std::max(value, low + options.tolerance / 2), high - options.tolerance / 2);
+            }
+
+            int numEvaluations = result.numEvaluations;
+            narrow(value);
+            numSlowSteps = high - low > width / 2 ? numSlowSteps + 1 : 0;
+            if (numEvaluations == result.numEvaluations and high - low == width) {
+                break; // no progress is possible (e.g., the tolerance is below the resolution of the doubles)
+            }
+        }
+    }
+
+    result.converged = !result.feasible or high - low <= options.tolerance;
+    result.value = high;
+    result.objective = highEvaluation.first;
+    result.results = highEvaluation.second;
+    return result;
+}
+
+M6SS::InverseSolver::Result M6SS::InverseSolver::solve(const SyncParameters &syncParams, Variable variable,
+                                                       duration<double> target, const Options &options) {
+    ModelCache cache(options.maxEvaluations, Model::Options(), 1);
+    return solve(syncParams, variable, target, options, cache);
+}
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_INVERSESOLVER_H
+#define M6SS_INVERSESOLVER_H
+
+#include <chrono>
+#include <memory>
+#include "syncparameters.h"
+#include "model.h"
+
+namespace M6SS {
+
+    class ModelCache; // forward declaration
+
+    /**
+     * This class solves the inverse problem of the model, i.e., it finds the minimum Peb, or the minimum scale of all
+     * the Psr values, for which the average synchronization time (or a percentile of it) does not exceed a target. The
+     * solver exploits that the synchronization time decreases as Peb or the Psr values increase: it keeps a bracket of
+     * the solution and narrows it through regula falsi (a secant step that never leaves the bracket) on the rate
+     * 1 / time, which is almost linear in Peb and in the scale of Psr, falling back to bisection when the secant steps
+     * do not narrow the bracket fast enough.
+     */
+    class InverseSolver {
+    public:
+        struct Options; // forward declaration
+        struct Result; // forward declaration
+
+        /**
+         * The variable that is solved for.
+         */
+        enum class Variable {
+            Peb, // the probability of an EB transmission, in (0, 1]
+            PsrScale // a factor by which all the Psr values are multiplied, in (0, 1 / max Psr]
+        };
+
+        /**
+         * Finds the minimum value of a variable for which the synchronization time does not exceed a target.
+         * @param syncParams the synchronization parameters; the value of the variable in them is ignored.
+         * @param variable the variable to solve for.
+         * @param target the target of the average synchronization time or of the percentile (see Options).
+         * @param options the options of the solver (see below).
+         * @param cache the cache through which the model is evaluated; its options control the accuracy.
+         * @return the result of the solver.
+         * @throw std::invalid_argument if target is not positive, if the options are not valid, or if variable is
+         * PsrScale and all the Psr values are zero.
+         */
+        static Result solve(const SyncParameters &syncParams, Variable variable, std::chrono::duration<double> target,
+                            const Options &options, ModelCache &cache);
+
+        /**
+         * The same as the function above, but the model is evaluated through a cache that is used only for this call.
+         */
+        static Result solve(const SyncParameters &syncParams, Variable variable, std::chrono::duration<double> target,
+                            const Options &options);
+
+        /**
+         * The options of the solver.
+         */
+        struct Options {
+            /**
+             * If zero, the target concerns the average synchronization time. Otherwise, it concerns the given
+             * percentile of the synchronization time (e.g., 0.95).
+             */
+            double percentile = 0;
+
+            /**
+             * The solver stops when the bracket of the solution is narrower than this (absolute) tolerance.
+             */
+            double tolerance = 1e-4;
+
+            /**
+             * The maximum number of model evaluations.
+             */
+            int maxEvaluations = 64;
+
+            /**
+             * An estimate of the solution (e.g., the solution for similar parameters), which is evaluated first to
+             * narrow the initial bracket. If zero, no estimate is used.
+             */
+            double initialGuess = 0;
+        };
+
+        /**
+         * The result of the solver.
+         */
+        struct Result {
+            double value; // the minimum value of the variable for which the target is met (within the tolerance)
+            bool feasible; // false if the target is not met even for the maximum value of the variable
+            bool converged; // false if maxEvaluations was reached before the tolerance
+            std::chrono::duration<double> objective; // the average or the percentile for value
+            std::shared_ptr<const Model::Results> results; // the results of the model for value
+            int numEvaluations; // the number of model evaluations (the results found in the cache are not counted)
+        };
+    };
+
+}
+
+#endif //M6SS_INVERSESOLVER_H
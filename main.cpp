@@ -26,8 +26,16 @@
 using namespace M6SS;
 using namespace std::chrono_literals;
 
+enum AveragePsrType {
+    ZeroStdDev, MaxStdDev
+};
+
+std::map<int, double> generatePsr(const std::vector<int> &chs, double averagePsr, AveragePsrType averagePsrType);
+
 void generateSimStatsFig8();
 
+void benchmarkModelFig8Grid();
+
 int main() {
     std::cout << "<----------------------------M6SS project---------------------------->" << std::endl;
     std::cout << "This is an example program of calculating the average initial-synchronization time using (a) the "
@@ -57,6 +65,25 @@ int main() {
 
 }
 
+std::map<int, double> generatePsr(const std::vector<int> &chs, double averagePsr, AveragePsrType averagePsrType) {
+    std::map<int, double> pSR;
+    if (averagePsrType == ZeroStdDev) {
+        for (int ch: chs) { pSR[ch] = averagePsr; }
+    } else {
+        double targetSum = averagePsr * chs.size();
+        int numOf1 = (int) targetSum;
+        double rem = targetSum - numOf1;
+        std::vector<double> temp;
+        for (int i = 0; i < numOf1; i++) {
+            temp.push_back(1);
+        };
+        if (temp.size() < chs.size()) { temp.push_back(rem); }
+        while (temp.size() < chs.size()) { temp.push_back(0); }
+        for (int i = 0; i < chs.size(); i++) { pSR[chs[i]] = temp[i]; }
+    }
+    return pSR;
+}
+
 void generateSimStatsFig8() {
     auto calculateCI = [](std::vector<double> &values, double confLevel) {
         std::sort(values.begin(), values.end());
@@ -80,29 +107,6 @@ void generateSimStatsFig8() {
 
     simStatsFig8CSV << "SD,c,s,b_avg,n,avgSyncTime,avgSyncTimeCIL,avgSyncTimeCIU" << std::endl;
 
-    enum AveragePsrType {
-        ZeroStdDev, MaxStdDev
-    };
-
-    auto generatePsr = [](const std::vector<int> &chs, double averagePsr, AveragePsrType averagePsrType) {
-        std::map<int, double> pSR;
-        if (averagePsrType == ZeroStdDev) {
-            for (int ch: chs) { pSR[ch] = averagePsr; }
-        } else {
-            double targetSum = averagePsr * chs.size();
-            int numOf1 = (int) targetSum;
-            double rem = targetSum - numOf1;
-            std::vector<double> temp;
-            for (int i = 0; i < numOf1; i++) {
-                temp.push_back(1);
-            };
-            if (temp.size() < chs.size()) { temp.push_back(rem); }
-            while (temp.size() < chs.size()) { temp.push_back(0); }
-            for (int i = 0; i < chs.size(); i++) { pSR[chs[i]] = temp[i]; }
-        }
-        return pSR;
-    };
-
     double pEB = 1;
     for (int c: {4, 8, 12, 16}) {
         auto &chs = M6SS::SyncParameters::DEFAULT_CHANNEL_HOPPING_SEQUENCES.at(c);
@@ -141,3 +145,74 @@ void generateSimStatsFig8() {
 
     simStatsFig8CSV.close();
 }
+
+
+/**
+ * Measures the throughput of the model over the points of the grid of the Figure 8 of the paper that fall in Cases 1
+ * and 2 (Case 3 is always calculated in double precision), in double and in mixed precision (see Model::Options), and
+ * reports the maximum differences between the two.
+ */
+void benchmarkModelFig8Grid() {
+    constexpr int NUM_SLOTS = 101;
+    constexpr int NUM_REPETITIONS = 100;
+
+    std::vector<SyncParameters> grid;
+    for (int c: {4, 8, 12, 16}) {
+        auto &chs = M6SS::SyncParameters::DEFAULT_CHANNEL_HOPPING_SEQUENCES.at(c);
+        for (double averagePsr : {0.25, 0.5, 0.75, 1.0})
+            for (auto averagePsrType: {ZeroStdDev, MaxStdDev}) {
+                auto pSR = generatePsr(chs, averagePsr, averagePsrType);
+                for (int i = 0; i <= 20; i++) {
+                    for (int j = 1; j <= 4; j++) {
+                        double n = i + j * 0.25;
+                        if (n > 1 and n != std::floor(n)) {
+                            continue; // Case 3
+                        }
+                        std::chrono::nanoseconds tScan = std::chrono::round<std::chrono::nanoseconds>(
+                                n * NUM_SLOTS * SyncParameters::DEFAULT_SLOT_DURATION
+                        );
+                        grid.emplace_back(chs, NUM_SLOTS, 1, pSR, tScan, 0ns, 4256us);
+                    }
+                }
+            }
+    }
+
+    auto run = [&](const Model::Options &options, std::vector<Model::Results> &results) {
+        results.assign(grid.size(), Model::Results());
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < NUM_REPETITIONS; r++) {
+            for (size_t i = 0; i < grid.size(); i++) {
+                Model::calculate(grid[i], results[i], options);
+            }
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start) / NUM_REPETITIONS;
+    };
+
+    Model::Options doubleOptions, mixedOptions;
+    doubleOptions.tolerance = mixedOptions.tolerance = 1e-4;
+    mixedOptions.precision = Model::Options::Precision::Mixed;
+
+    std::vector<Model::Results> doubleResults, mixedResults;
+    auto doubleTime = run(doubleOptions, doubleResults);
+    auto mixedTime = run(mixedOptions, mixedResults);
+
+    long numSinglePrecision = 0;
+    double maxRelativeError = 0, maxEstimatedError = 0;
+    for (size_t i = 0; i < grid.size(); i++) {
+        if (!mixedResults[i].isSinglePrecision()) {
+            continue;
+        }
+        numSinglePrecision++;
+        maxRelativeError = std::max(maxRelativeError, std::abs(
+                (mixedResults[i].avgSyncTime() - doubleResults[i].avgSyncTime()) / doubleResults[i].avgSyncTime()));
+        maxEstimatedError = std::max(maxEstimatedError,
+                                     mixedResults[i].avgSyncTimeError() / mixedResults[i].avgSyncTime());
+    }
+
+    std::cout << "<-----Model Throughput (Figure 8 grid, Cases 1 and 2, " << grid.size() << " points)----->" << std::endl;
+    std::cout << "Double precision: " << grid.size() / doubleTime.count() << " points/s" << std::endl;
+    std::cout << "Mixed precision: " << grid.size() / mixedTime.count() << " points/s ("
+              << numSinglePrecision << " points in single precision)" << std::endl;
+    std::cout << "Max relative difference in avgSyncTime: " << maxRelativeError
+              << " (max estimated relative error: " << maxEstimatedError << ")" << std::endl;
+}
@@ -16,259 +16,682 @@
  */
 
 #include <cmath>
-#include <functional>
 #include <numeric>
+#include <limits>
+#include <algorithm>
+#include <mutex>
+#include <type_traits>
 #include "model.h"
 #include "timeinterval.h"
+#include "scanperiodgeometry.h"
+#include "psynckernel.h"
+#include "compensatedsum.h"
+#include "threadpool.h"
+#include "parameterbatch.h"
+#include "dual.h"
 
 using std::chrono::duration, std::chrono::nanoseconds, std::floor, std::ceil, std::size_t, std::pow;
 using namespace std::chrono_literals;
 
 M6SS::Model::Results &
 M6SS::Model::calculate(const SyncParameters &syncParams, Results &results) {
+    return calculate(syncParams, results, Options());
+}
 
-    const double &Peb = syncParams.getPeb();
-    const int C = syncParams.getCHS().size();
-    const std::vector<int> &chs = syncParams.getCHS();
-    const std::map<int, double> &Psr = syncParams.getPsr();
-    const nanoseconds &Tscan = syncParams.getTScan();
-    const nanoseconds Tsf = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
-    const nanoseconds &Teb = syncParams.getTeb();
-    duration<double> Tavg_sync = 0s;
-    size_t max_step;
-
-    std::function<double(size_t)> Psync;
+namespace {
+
+    /* The quantities that are calculated by the model, where Real is double, or a Dual for the sensitivities. */
+    template<class Real>
+    struct Calculation {
+        Real avgSyncTime = 0; // in seconds
+        std::vector<Real> pSync; // Psync(k) for k = 0, 1, 2, ..., where Psync(0) = 0
+        // the absolute errors of avgSyncTime and of the cdf, due to the termination of the calculation
+        duration<double> truncationErrorInAVG = 0s;
+        double truncationErrorInCDF = 0;
+        double epsilon = std::numeric_limits<double>::epsilon(); // the machine epsilon of the probability calculations
+        bool singlePrecision = false;
+    };
 
-    auto sumOfExpectedValueInCases1and2 = [&Psync, &Tsf, &Teb, &max_step] {
-        /* calculates the sum of Psync(k) * [(k-1) * Tsf + Tsf/2 + Teb] from k=1 to infinity */
+    /* The calculation of the model (see Model::calculate), where Peb and Psr are given separately from syncParams so
+     * that they can be the variables of the sensitivities. */
+    template<class Real>
+    void calculateModel(const M6SS::SyncParameters &syncParams, const Real &Peb, const std::map<int, Real> &Psr,
+                        const M6SS::Model::Options &options, Calculation<Real> &calculation) {
+        using M6SS::SyncParameters, M6SS::Model, M6SS::PsyncKernel, M6SS::NeumaierSum, M6SS::TimeInterval,
+        M6SS::ScanPeriodGeometry;
+
+        const int C = syncParams.getCHS().size();
+        const std::vector<int> &chs = syncParams.getCHS();
+        const nanoseconds &Tscan = syncParams.getTScan();
+        const nanoseconds Tsf = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
+        const nanoseconds &Teb = syncParams.getTeb();
+        const double tolerance = options.tolerance;
+        double &epsilon = calculation.epsilon;
+        Real &Tavg_sync = calculation.avgSyncTime; // in seconds
+        duration<double> &truncationErrorInAVG = calculation.truncationErrorInAVG;
+        double &truncationErrorInCDF = calculation.truncationErrorInCDF;
+
+        std::vector<Real> &pSyncArray = calculation.pSync; // an array to store Psync for each step
+        pSyncArray.push_back(0);
 
-        duration<double> sum = 0s;
-        size_t k = 1;
-        double cumulativeProb = 0;
-        while (cumulativeProb < 1 - std::pow(10, -9)) { // Runs until the cumulative probability reaches 0.999999999.
-            cumulativeProb += Psync(k);
-            sum += Psync(k) * ((k - 1) * Tsf + Tsf / 2.0 + Teb);
-            k += 1;
-        }
+        auto sumOfExpectedValueInCases1and2 = [&](auto &&Psync) {
+            /* calculates the sum of Psync(k) * [(k-1) * Tsf + Tsf/2 + Teb] from k=1 to infinity */
+
+            NeumaierSum<Real> sum; // in seconds
+            NeumaierSum<Real> cumulativeProb;
+            size_t k = 1;
+            // Runs until the cumulative probability reaches 1 - tolerance, or the steps reach the memory cap
+            while (cumulativeProb.value() < 1 - tolerance and
+                   (options.maxMemory == 0 or pSyncArray.size() * sizeof(Real) < options.maxMemory)) {
+                if (options.cancellation and k % Model::Options::CANCELLATION_POLL_INTERVAL == 0) {
+                    options.cancellation->throwIfCancelled();
+                }
 
-        max_step = k - 1;
+                Real p = Psync.next();
+                pSyncArray.push_back(p);
+                cumulativeProb += p;
+                sum += p * duration<double>((k - 1) * Tsf + Tsf / 2.0 + Teb).count();
+                k += 1;
+            }
 
-        return sum;
-    };
+            // the synchronization time in a step k is at most k * Tsf + Teb
+            auto tail = Psync.tail();
+            truncationErrorInAVG = tail.stepsBound * Tsf + tail.mass * Teb;
+            truncationErrorInCDF = tail.mass;
 
-    std::vector<int> W;
-    W.reserve(C);
-    for (int i = 1; i <= C; i++) {
-        // note that both the slotOffset and the channelOffset of the minimal cell are zero
-        W.push_back(chs[((i - 1) * syncParams.getS()) % C]);
-    }
+            return sum.value();
+        };
 
-    auto X = [&W, &C](int k, int y) {
-        return W[(y + k - 1) % C];
-    };
+        std::vector<int> W;
+        W.reserve(C);
+        for (int i = 1; i <= C; i++) {
+            // note that both the slotOffset and the channelOffset of the minimal cell are zero
+            W.push_back(chs[((i - 1) * syncParams.getS()) % C]);
+        }
 
-    auto Pstep = [&C, &Peb, &Psr, &X](int k, int y) {
-        return 1.0 / C * Peb * Psr.at(X(k, y));
-    };
+        // the probability Pstep of an EB reception in a step where the minimal cell uses the channel W(w+1)
+        auto Pstep = [&C, &Peb, &Psr, &W](int w) {
+            return 1.0 / C * Peb * Psr.at(W[w]);
+        };
 
-    if (Tscan < Tsf) { // Case 1: The scan period is shorter than the duration of a step (or a slotframe)
+        // Pstep and the probability of not receiving an EB, for each channel of W
+        std::vector<Real> PstepW, PnoReceptionW;
+        PstepW.reserve(C);
+        PnoReceptionW.reserve(C);
+        for (int channel: W) {
+            PstepW.push_back(1.0 / C * Peb * Psr.at(channel));
+            PnoReceptionW.push_back(1 - Peb * Psr.at(channel));
+        }
 
-        auto Psync_cond = [&Pstep](int k, int y) {
-            double prod = 1;
-            for (int i = 1; i <= k - 1; i++) {
-                prod *= 1 - Pstep(i, y);
+        auto calculateCases1and2 = [&](long n) {
+            if constexpr (std::is_same_v<Real, double>) {
+                if (options.precision == Model::Options::Precision::Mixed and
+                    tolerance >= Model::Options::MIN_MIXED_PRECISION_TOLERANCE) {
+                    Tavg_sync = sumOfExpectedValueInCases1and2(PsyncKernel<float>(
+                            std::vector<float>(PstepW.begin(), PstepW.end()),
+                            std::vector<float>(PnoReceptionW.begin(), PnoReceptionW.end()), n));
+
+                    // the a-posteriori estimate of the relative rounding error (see below)
+                    double relativeRoundingError = 2 * (pSyncArray.size() - 1) * std::numeric_limits<float>::epsilon();
+                    if (relativeRoundingError <= options.maxMixedPrecisionError) {
+                        epsilon = std::numeric_limits<float>::epsilon();
+                        calculation.singlePrecision = true;
+                        return;
+                    }
+
+                    pSyncArray.resize(1); // repeat the calculation in double precision
+                }
             }
-            prod *= Pstep(k, y);
-            return prod;
-        };
 
-        Psync = [Psync_cond, &C](int k) {
-            double sum = 0;
-            for (int y = 0; y <= C - 1; y++) {
-                sum += 1.0 / C * Psync_cond(k, y);
-            }
-            return sum;
+            Tavg_sync = sumOfExpectedValueInCases1and2(PsyncKernel<Real>(PstepW, PnoReceptionW, n));
         };
 
-        Tavg_sync = sumOfExpectedValueInCases1and2();
+        if (Tscan < Tsf) { // Case 1: The scan period is shorter than the duration of a step (or a slotframe)
 
+            // Case 1 is equivalent to Case 2 with a single step in each scan period
+            calculateCases1and2(1);
 
-    } else if (Tscan % Tsf == 0ns) { // Case 2: The scan period is an integer multiple of the step (or the slotframe)
-        int n = Tscan / Tsf;
+        } else if (Tscan % Tsf == 0ns) { // Case 2: The scan period is an integer multiple of the step (or the slotframe)
+            int n = Tscan / Tsf;
 
-        auto Pstep_sp = [n, &C, &Peb, &Psr, &X, &Pstep](int k, int y) {
-            int k_f = ((k - 1) / n) * n + 1;
-            int Nchp = (k - k_f) / C;
-            return pow(1 - Peb * Psr.at(X(k, y)), Nchp) * Pstep(k, y);
-        };
+            calculateCases1and2(n);
+
+        } else { // Case 3: The scan period is greater than the step, but is not an integer multiple of the step
 
-        auto Qsp = [n, Pstep_sp](int i, int y) {
-            double sum = 0;
-            for (int k = (i - 1) * n + 1; k <= i * n; k++) {
-                sum += Pstep_sp(k, y);
+            auto updatePSync = [&pSyncArray](size_t k, const Real &p) {
+                if (k >= pSyncArray.size()) {
+                    pSyncArray.push_back(p);
+                } else {
+                    pSyncArray[k] += p;
+                }
+            };
+
+            // the probability of the scan periods that are not examined and the sum of their start times (weighted by
+            // their probabilities), for the bound of the truncation error
+            NeumaierSum<double> discardedProb;
+            NeumaierSum<double> discardedStartTime; // in seconds
+
+            // the contribution (in seconds) of a synchronization with probability p at the time t to the expected value
+            auto E = [](const Real &p, duration<double, std::nano> t) -> Real {
+                return p * t.count() / 1e9;
+            };
+
+            // The scan periods are examined level by level, i.e., the scan periods i of all the lanes before the scan
+            // periods i + 1, instead of recursively, so that the number of the scan periods up to the tolerance (which
+            // is large for a low Psr) is not limited by the stack. Each scan period splits the interval of the EB point
+            // between its next scan periods, so the intervals of a level of a lane are disjoint, and only the current
+            // and the next level are kept in memory.
+            struct ScanPeriod {
+                int y;
+                TimeInterval I;
+                Real q;
+            };
+            std::vector<ScanPeriod> level, nextLevel;
+            for (int y = 0; y < C; y++) {
+                level.push_back(ScanPeriod{y, TimeInterval(0ns, Tsf), 1.0});
             }
 
-            return 1 - sum;
-        };
+            std::vector<NeumaierSum<Real> > laneSums(C); // the expected value of each lane, in seconds
+
+            for (size_t i = 1; not level.empty(); i++) {
+                if (options.cancellation) {
+                    options.cancellation->throwIfCancelled();
+                }
+
+                if (options.maxMemory > 0 and pSyncArray.capacity() * sizeof(Real) +
+                                              (level.capacity() + nextLevel.capacity()) * sizeof(ScanPeriod) >
+                                              options.maxMemory) {
+                    // the memory cap is reached; the remaining scan periods are discarded
+                    for (const ScanPeriod &period: level) {
+                        discardedProb += 1.0 / C * static_cast<double>(period.q);
+                        discardedStartTime += 1.0 / C * static_cast<double>(period.q) *
+                                              duration<double>((i - 1) * Tscan).count();
+                    }
+                    break;
+                }
+
+                for (const ScanPeriod &period: level) {
+                    const int y = period.y;
+                    const TimeInterval &I = period.I;
+                    const Real &q = period.q;
+
+                    if (q < tolerance) {
+                        discardedProb += 1.0 / C * static_cast<double>(q);
+                        discardedStartTime += 1.0 / C * static_cast<double>(q) *
+                                              duration<double>((i - 1) * Tscan).count();
+                        continue;
+                    }
+
+                    // the steps of the scan period, their channels and the intervals of the next scan periods
+                    const ScanPeriodGeometry geometry(Tscan, Tsf, Teb, C, i, y, I);
+                    const size_t k_f = geometry.firstStep();
+                    const size_t k_l = geometry.lastStep();
+
+                    Real Pstep_first = geometry.coversFirstStep() ? Pstep(geometry.channel(k_f)) : Real(0);
+                    Real Psync_first = q * Pstep_first;
+                    Real E_first = E(Psync_first, geometry.time(k_f));
+
+                    auto Pstep_inter = [&](size_t k) { // for kf < k ≤ kl
+                        const int w = geometry.channel(k);
+                        return pow(1 - Peb * Psr.at(W[w]), geometry.exponent(k)) * Pstep(w);
+                    };
+
+                    auto Psync_inter = [&](size_t k) { //for kf < k < kl
+                        return q * Pstep_inter(k);
+                    };
+
+                    auto Einter = [&](size_t k) { // for kf < k < kl
+                        return E(Psync_inter(k), geometry.time(k));
+                    };
+
+
+                    //Plsc -> Plast_step_covered
+                    const double Plsc = geometry.lastStepCoverage();
+                    Real Pstep_last = Pstep_inter(k_l);
+                    Real Psync_last = q * Plsc * Pstep_last;
+
+                    const TimeInterval &Z = geometry.coveredNext();
+                    Real Elast = !Z.isEmpty() ? E(Psync_last, geometry.time(k_l)) : Real(0);
+
+                    Real sum_p_inter_step = 0;
+                    for (size_t k = k_f + 1; k <= k_l - 1; k++) {
+                        sum_p_inter_step += Pstep_inter(k);
+                    }
+
+                    Real Q_C = q * Plsc * (1 - (Pstep_first + Pstep_last + sum_p_inter_step));
+
+                    const TimeInterval &NC = geometry.notCoveredNext();
+                    Real Q_NC = q * geometry.notCoveredFraction() * (1 - (Pstep_first + sum_p_inter_step));
+
+                    NeumaierSum<Real> &res = laneSums[y];
+                    res += E_first;
+                    updatePSync(k_f, 1.0 / C * Psync_first); // for the calculation of CDF
+
+                    size_t k = k_f + 1;
+                    while (k <= k_l - 1) {
+                        res += Einter(k);
+                        updatePSync(k, 1.0 / C * Psync_inter(k)); // for the calculation of CDF
+                        k++;
+                    }
 
-        auto Psync_cond = [n, Qsp, Pstep_sp](int k, int y) {
-            double prod = 1;
-            for (int i = 1; i <= (k - 1) / n; i++) {
-                prod *= Qsp(i, y);
+                    res += Elast;
+
+                    updatePSync(k_l, 1.0 / C * Psync_last); // for the calculation of CDF
+
+                    // the next scan periods; those with an empty interval do not contribute
+                    if (!Z.isEmpty()) {
+                        nextLevel.push_back(ScanPeriod{y, Z, Q_C});
+                    }
+
+                    if (!NC.isEmpty()) {
+                        nextLevel.push_back(ScanPeriod{y, NC, Q_NC});
+                    }
+                }
+
+                level.swap(nextLevel);
+                nextLevel.clear();
             }
-            return prod * Pstep_sp(k, y);
-        };
 
-        Psync = [Psync_cond, &C](int k) {
-            double sum = 0;
-            for (int y = 0; y <= C - 1; y++) {
-                sum += 1.0 / C * Psync_cond(k, y);
+            NeumaierSum<Real> sum; // in seconds
+            for (int y = 0; y < C; y++) {
+                sum += 1.0 / C * laneSums[y].value();
             }
-            return sum;
-        };
+            Tavg_sync = sum.value();
 
-        Tavg_sync = sumOfExpectedValueInCases1and2();
+            std::vector<double> pStep;
+            for (const Real &p: PstepW) {
+                pStep.push_back(static_cast<double>(p));
+            }
+            truncationErrorInAVG = ScanPeriodGeometry::discardedTimeBound(Tscan, Tsf, Teb, pStep, discardedProb.value(),
+                                                                          duration<double>(discardedStartTime.value()));
+            truncationErrorInCDF = discardedProb.value();
+        }
+    }
 
 
-    } else { // Case 3: The scan period is greater than the step, but is not an integer multiple of the step
+    /*
+     * Makes the calculation with dual numbers of size N (at least C + 1), whose variables are Peb (index 0) and the
+     * Psr of each channel (index i + 1 for the channel chs[i]), and separates the values from the derivatives. The
+     * derivatives of the cdf are the cumulative sums of the derivatives of the probabilities.
+     */
+    template<int N>
+    void calculateDerivatives(const M6SS::SyncParameters &syncParams, const M6SS::Model::Options &options,
+                              Calculation<double> &values, std::vector<double> &avgSyncTimeDerivatives,
+                              std::vector<std::vector<double> > &cdfDerivatives) {
+        using Dual = M6SS::Dual<N>;
+
+        const std::vector<int> &chs = syncParams.getCHS();
+        const Dual Peb = Dual::variable(syncParams.getPeb(), 0);
+        std::map<int, Dual> Psr;
+        for (size_t i = 0; i < chs.size(); i++) {
+            Psr[chs[i]] = Dual::variable(syncParams.getPsr().at(chs[i]), i + 1);
+        }
 
-        const double n = Tscan * 1.0 / Tsf;
-        std::vector<double> pSyncArray; // an array to store Psync for each step
-        pSyncArray.push_back(0);
-        auto updatePSync = [&pSyncArray](size_t k, double p) {
-            if (k >= pSyncArray.size()) {
-                pSyncArray.push_back(p);
-            } else {
-                pSyncArray[k] += p;
+        Calculation<Dual> calculation;
+        calculateModel(syncParams, Peb, Psr, options, calculation);
+
+        values.avgSyncTime = calculation.avgSyncTime.value();
+        values.pSync.clear();
+        values.pSync.reserve(calculation.pSync.size());
+        for (const Dual &p: calculation.pSync) {
+            values.pSync.push_back(p.value());
+        }
+        values.truncationErrorInAVG = calculation.truncationErrorInAVG;
+        values.truncationErrorInCDF = calculation.truncationErrorInCDF;
+        values.epsilon = calculation.epsilon;
+
+        const size_t numVariables = chs.size() + 1;
+        avgSyncTimeDerivatives.assign(numVariables, 0);
+        cdfDerivatives.assign(numVariables, std::vector<double>(1, 0));
+        for (size_t v = 0; v < numVariables; v++) {
+            avgSyncTimeDerivatives[v] = calculation.avgSyncTime.derivative(v);
+            M6SS::NeumaierSum<double> cumulativeDerivative;
+            cdfDerivatives[v].reserve(calculation.pSync.size());
+            for (size_t k = 1; k < calculation.pSync.size(); k++) {
+                cumulativeDerivative += calculation.pSync[k].derivative(v);
+                cdfDerivatives[v].push_back(cumulativeDerivative.value());
             }
-        };
+        }
+    }
+}
+
+M6SS::Model::Results &
+M6SS::Model::calculate(const SyncParameters &syncParams, Results &results, const Options &options) {
+
+    if (not(options.tolerance > 0 and options.tolerance < 1)) {
+        throw std::invalid_argument("tolerance must be in the range (0, 1).");
+    }
+
+    Calculation<double> calculation;
+    calculateModel(syncParams, syncParams.getPeb(), syncParams.getPsr(), options, calculation);
 
-        auto B = [n](size_t i) { return (i - 1) * n != floor((i - 1) * n); };
+    results.singlePrecision_ = calculation.singlePrecision;
+    results.assign(duration<double>(calculation.avgSyncTime), calculation.pSync, calculation.truncationErrorInAVG,
+                   calculation.truncationErrorInCDF, calculation.epsilon, syncParams, options.tolerance);
+
+    return results;
+}
+
+M6SS::Model::Results &
+M6SS::Model::calculate(const SyncParameters &syncParams, Results &results, Sensitivities &sensitivities) {
+    return calculate(syncParams, results, sensitivities, Options());
+}
+
+M6SS::Model::Results &
+M6SS::Model::calculate(const SyncParameters &syncParams, Results &results, Sensitivities &sensitivities,
+                       const Options &options) {
+
+    if (not(options.tolerance > 0 and options.tolerance < 1)) {
+        throw std::invalid_argument("tolerance must be in the range (0, 1).");
+    }
+
+    Options doublePrecision = options; // the derivatives are always calculated in double precision
+    doublePrecision.precision = Options::Precision::Double;
+
+    // the cost of each operation on the dual numbers grows with their size, so use the smallest that fits
+    Calculation<double> calculation;
+    std::vector<double> avgSyncTimeDerivatives;
+    std::vector<std::vector<double> > cdfDerivatives;
+    const size_t C = syncParams.getCHS().size();
+    if (C <= 4) {
+        calculateDerivatives<5>(syncParams, doublePrecision, calculation, avgSyncTimeDerivatives, cdfDerivatives);
+    } else if (C <= 8) {
+        calculateDerivatives<9>(syncParams, doublePrecision, calculation, avgSyncTimeDerivatives, cdfDerivatives);
+    } else {
+        calculateDerivatives<17>(syncParams, doublePrecision, calculation, avgSyncTimeDerivatives, cdfDerivatives);
+    }
+
+    results.singlePrecision_ = false;
+    results.assign(duration<double>(calculation.avgSyncTime), calculation.pSync, calculation.truncationErrorInAVG,
+                   calculation.truncationErrorInCDF, calculation.epsilon, syncParams, options.tolerance);
+
+    sensitivities.chs_ = syncParams.getCHS();
+    sensitivities.avgSyncTime_.clear();
+    for (double derivative: avgSyncTimeDerivatives) {
+        sensitivities.avgSyncTime_.emplace_back(derivative);
+    }
+    sensitivities.cdf_ = std::move(cdfDerivatives);
+
+    return results;
+}
+
+std::vector<M6SS::Model::Results> &
+M6SS::Model::calculateBatch(const std::vector<SyncParameters> &syncParamsSet, std::vector<Results> &results,
+                            const Options &options) {
+    return calculateBatch(syncParamsSet, results, options, ThreadPool::shared());
+}
+
+std::vector<M6SS::Model::Results> &
+M6SS::Model::calculateBatch(const std::vector<SyncParameters> &syncParamsSet, std::vector<Results> &results,
+                            const Options &options, ThreadPool &pool) {
+
+    if (not(options.tolerance > 0 and options.tolerance < 1)) {
+        throw std::invalid_argument("tolerance must be in the range (0, 1).");
+    }
 
-        std::function<duration<double>(double, size_t, const TimeInterval &, int)> recursiveCalc;
-        recursiveCalc = [&](double q, size_t i, const TimeInterval &I, int y) -> duration<double> {
+    results.resize(syncParamsSet.size());
 
-            if (I.isEmpty() or q < std::pow(10, -9)) {
-                return 0s;
+    // Start with the parameter sets of Case 3, whose calculation may take orders of magnitude longer than that of the
+    // other cases, so that they do not end up at the tail of the batch.
+    auto isCase3 = [](const SyncParameters &syncParams) {
+        const nanoseconds Tsf = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
+        return syncParams.getTScan() > Tsf and syncParams.getTScan() % Tsf != 0ns;
+    };
+
+    std::vector<size_t> order(syncParamsSet.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_partition(order.begin(), order.end(),
+                          [&](size_t i) { return isCase3(syncParamsSet[i]); });
+
+    pool.parallelFor(order.size(), [&](size_t i) {
+        calculate(syncParamsSet[order[i]], results[order[i]], options);
+    });
+
+    return results;
+}
+
+std::vector<M6SS::Model::Results> &
+M6SS::Model::calculateBatch(const ParameterBatch &batch, std::vector<Results> &results, const Options &options) {
+    return calculateBatch(batch, results, options, ThreadPool::shared());
+}
+
+std::vector<M6SS::Model::Results> &
+M6SS::Model::calculateBatch(const ParameterBatch &batch, std::vector<Results> &results, const Options &options,
+                            ThreadPool &pool) {
+
+    if (not(options.tolerance > 0 and options.tolerance < 1)) {
+        throw std::invalid_argument("tolerance must be in the range (0, 1).");
+    }
+
+    const int C = batch.getCHS().size();
+    const nanoseconds &Tscan = batch.getTScan();
+    const nanoseconds Tsf = SyncParameters::DEFAULT_SLOT_DURATION * batch.getS();
+    const nanoseconds &Teb = batch.getTeb();
+    const double tolerance = options.tolerance;
+
+    if (Tscan > Tsf and Tscan % Tsf != 0ns) { // Case 3; there is no batch kernel, so evaluate each parameter set
+        std::vector<SyncParameters> syncParamsSet;
+        syncParamsSet.reserve(batch.size());
+        for (size_t i = 0; i < batch.size(); i++) {
+            syncParamsSet.push_back(batch.at(i));
+        }
+        return calculateBatch(syncParamsSet, results, options, pool);
+    }
+
+    const long n = Tscan < Tsf ? 1 : Tscan / Tsf; // Case 1 is equivalent to Case 2 with n = 1
+    results.resize(batch.size());
+
+    std::vector<int> W;
+    W.reserve(C);
+    for (int i = 1; i <= C; i++) {
+        W.push_back(batch.getCHS()[((i - 1) * batch.getS()) % C]);
+    }
+
+    // Group the parameter sets with similar probabilities of synchronization in each slotframe, so that the sets of a
+    // block require a similar number of steps.
+    std::vector<size_t> order(batch.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<double> successProb(batch.size(), 0);
+    for (int channel: batch.getCHS()) {
+        for (size_t j = 0; j < batch.size(); j++) {
+            successProb[j] += batch.getPebColumn()[j] * batch.getPsrColumn(channel)[j];
+        }
+    }
+    std::sort(order.begin(), order.end(), [&successProb](size_t a, size_t b) {
+        return successProb[a] < successProb[b];
+    });
+
+    // the parameter sets whose calculation in single precision was not accurate enough
+    std::vector<size_t> repeatInDoublePrecision;
+    std::mutex repeatMutex;
+
+    auto calculateBlock = [&](auto real, size_t first, size_t last) { // real: a value of the floating point type to use
+        using Real = decltype(real);
+        const double epsilon = std::numeric_limits<Real>::epsilon();
+        // the parameter sets of the block; the i-th set of the kernel is sets[i]
+        std::vector<size_t> sets(order.begin() + first, order.begin() + last);
+
+        std::vector<std::vector<double> > PstepW(C, std::vector<double>(sets.size()));
+        std::vector<std::vector<double> > PnoReceptionW(C, std::vector<double>(sets.size()));
+        for (int i = 0; i < C; i++) {
+            const std::vector<double> &Psr = batch.getPsrColumn(W[i]);
+            for (size_t j = 0; j < sets.size(); j++) {
+                double Peb = batch.getPebColumn()[sets[j]];
+                PstepW[i][j] = 1.0 / C * Peb * Psr[sets[j]];
+                PnoReceptionW[i][j] = 1 - Peb * Psr[sets[j]];
             }
+        }
 
-            duration<double> res;
-            // declare here the variables needed for recursive calls
-            double Q_C, Q_NC;
-            TimeInterval Rl(
-                    i * Tscan % Tsf, // equivalent to (i * n - floor(i*n)) * Tsf,
-                    Tsf
-            );
-            TimeInterval Ll(
-                    0ns,
-                    i * Tscan % Tsf // equivalent to (i*n - floor(i*n)) * Tsf
-            );
-            TimeInterval Z = B(i + 1) ? TimeInterval::intersection(I, Ll) : I;
-
-            {   // we define here an internal scope to release the variables that do not need to be retained during the
-                // recursive calls so that to prevent from stack overflow
-                size_t k_f = B(i) ? ceil((i - 1) * n) : (i - 1) * n + 1;
-                size_t k_l = ceil(i * n);
-                bool doesTheFirstStepOfScanPeriodCoverEBPoint = !B(i) or I.isSubsetOf(
-                        TimeInterval( //Rf
-                                (i - 1) * Tscan % Tsf, // equivalent to ((i - 1) * n - floor((i - 1) * n)) * Tsf
-                                Tsf)
-                );
-
-                double Pstep_first = doesTheFirstStepOfScanPeriodCoverEBPoint ? Pstep(k_f, y) : 0;
-                double Psync_first = q * Pstep_first;
-                duration<double> E_first =
-                        Psync_first * ((k_f - 1) * Tsf + I.getStart().value() + I.length() / 2.0 + Teb);
-
-
-                auto M = [&](size_t k) { //for kf <= k < kl
-                    return doesTheFirstStepOfScanPeriodCoverEBPoint ? k - k_f + 1 : k - k_f;
-                };
-
-                auto Pstep_inter = [&](size_t k) {
-                    return pow(1 - Peb * Psr.at(X(k, y)), (M(k) - 1) / C) * Pstep(k, y);
-                };
-
-                auto Psync_inter = [&](size_t k) { //for kf < k < kl
-                    return q * Pstep_inter(k);
-                };
-
-                auto Einter = [&](size_t k) { // for kf < k < kl
-                    return Psync_inter(k) * ((k - 1) * Tsf + I.getStart().value() + I.length() / 2.0 + Teb);
-                };
-
-
-                //Plsc -> Plast_step_covered
-                double Plsc = B(i + 1) ? TimeInterval::intersection(I, Ll).length() * 1.0 / I.length() : 1;
-                double Pstep_last = pow(1 - Peb * Psr.at(X(k_l, y)), (M(k_l - 1)) / C) * Pstep(k_l, y);
-                double Psync_last = q * Plsc * Pstep_last;
-
-                duration<double> Elast = (!Z.isEmpty() ?
-                                          Psync_last * ((k_l - 1) * Tsf + Z.getStart().value() + Z.length() / 2.0 + Teb)
-                                                       : 0s);
-
-                double sum_p_inter_step = 0;
-                for (size_t k = k_f + 1; k <= k_l - 1; k++) {
-                    sum_p_inter_step += Pstep_inter(k);
-                }
+        PsyncBatchKernel<Real> Psync(PstepW, PnoReceptionW, n);
+        std::vector<double> p(sets.size());
+        std::vector<std::vector<double> > pSyncArrays(sets.size(), std::vector<double>(1, 0));
+        std::vector<NeumaierSum<double> > sums(sets.size()), cumulativeProbs(sets.size());
+        std::vector<bool> completed(sets.size(), false);
+        size_t numCompleted = 0;
 
-                Q_C = q * Plsc * (1 - (Pstep_first + Pstep_last + sum_p_inter_step));
+        size_t k = 1;
+        do { // Runs until the cumulative probability of each set reaches 1 - tolerance
+            if (options.cancellation and k % Options::CANCELLATION_POLL_INTERVAL == 0) {
+                options.cancellation->throwIfCancelled();
+            }
 
-                Q_NC = q * (TimeInterval::intersection(I, Rl).length() * 1.0 / I.length()) *
-                       (1 - (Pstep_first + sum_p_inter_step));
+            Psync.next(p.data());
+            const double t = duration<double>((k - 1) * Tsf + Tsf / 2.0 + Teb).count();
+            for (size_t j = 0; j < sets.size(); j++) {
+                if (completed[j]) {
+                    continue;
+                }
 
-                res = E_first; // the variable 'res' holds the result
-                updatePSync(k_f, 1.0 / C * Psync_first); // for the calculation of CDF
+                pSyncArrays[j].push_back(p[j]);
+                cumulativeProbs[j] += p[j];
+                sums[j] += p[j] * t;
 
-                size_t k = k_f + 1;
-                while (k <= k_l - 1) {
-                    res += Einter(k);
-                    updatePSync(k, 1.0 / C * Psync_inter(k)); // for the calculation of CDF
-                    k++;
+                if (cumulativeProbs[j].value() < 1 - tolerance and
+                    (options.maxMemory == 0 or pSyncArrays[j].size() * sizeof(double) < options.maxMemory)) {
+                    continue;
                 }
 
-                res += Elast;
+                PsyncTail tail = Psync.tail(j);
+                Results &setResults = results[sets[j]];
+                setResults.assign(duration<double>(sums[j].value()), pSyncArrays[j],
+                                  tail.stepsBound * Tsf + tail.mass * Teb, tail.mass, epsilon, batch.at(sets[j]),
+                                  tolerance);
+                setResults.singlePrecision_ = std::is_same_v<Real, float>;
 
-                updatePSync(k_l, 1.0 / C * Psync_last); // for the calculation of CDF
-            }
-            res += recursiveCalc(Q_C, i + 1, Z, y);
+                if (setResults.singlePrecision_ and 2 * k * epsilon > options.maxMixedPrecisionError) {
+                    std::lock_guard<std::mutex> guard(repeatMutex);
+                    repeatInDoublePrecision.push_back(sets[j]);
+                }
 
-            if (B(i + 1)) {
-                res += recursiveCalc(Q_NC, i + 1, TimeInterval::intersection(I, Rl), y);
+                completed[j] = true;
+                numCompleted++;
+                std::vector<double>().swap(pSyncArrays[j]);
             }
 
-            return res;
-        };
+            if (numCompleted > 0 and numCompleted >= sets.size() / 4) { // remove the completed sets from the kernel
+                std::vector<size_t> keep;
+                for (size_t j = 0; j < sets.size(); j++) {
+                    if (!completed[j]) {
+                        sets[keep.size()] = sets[j];
+                        pSyncArrays[keep.size()].swap(pSyncArrays[j]);
+                        sums[keep.size()] = sums[j];
+                        cumulativeProbs[keep.size()] = cumulativeProbs[j];
+                        keep.push_back(j);
+                    }
+                }
+                Psync.compact(keep);
+                sets.resize(keep.size());
+                pSyncArrays.resize(keep.size());
+                completed.assign(keep.size(), false);
+                numCompleted = 0;
+            }
+            k++;
+        } while (!sets.empty());
+    };
 
-        for (int y = 0; y < C; y++) {
-            Tavg_sync += 1.0 / C * recursiveCalc(1.0, 1, TimeInterval(0ns, Tsf), y);
+    const bool mixed = options.precision == Options::Precision::Mixed and
+                       tolerance >= Options::MIN_MIXED_PRECISION_TOLERANCE;
+    const size_t numBlocks = (batch.size() + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+    pool.parallelFor(numBlocks, [&](size_t b) {
+        size_t first = b * BATCH_BLOCK_SIZE, last = std::min(batch.size(), first + BATCH_BLOCK_SIZE);
+        if (mixed) {
+            calculateBlock(0.0f, first, last);
+        } else {
+            calculateBlock(0.0, first, last);
         }
+    });
 
-        max_step = pSyncArray.size() - 1;
+    Options doubleOptions = options;
+    doubleOptions.precision = Options::Precision::Double;
+    pool.parallelFor(repeatInDoublePrecision.size(), [&](size_t i) {
+        calculate(batch.at(repeatInDoublePrecision[i]), results[repeatInDoublePrecision[i]], doubleOptions);
+    });
 
-        Psync = [pSyncArray](int k) {
-            return pSyncArray.at(k);
-        };
+    return results;
+}
 
+void M6SS::Model::Results::assign(std::chrono::duration<double> avgSyncTime, const std::vector<double> &pSync,
+                                  std::chrono::duration<double> truncationErrorInAVG, double truncationErrorInCDF,
+                                  double epsilon, const SyncParameters &syncParams, double tolerance) {
+    avgSyncTime_ = avgSyncTime;
+    Tsf_ = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
+    Teb_ = syncParams.getTeb();
+
+    const size_t max_step = pSync.size() - 1; // zero if the memory cap was reached before the first step
+    std::vector<double> cdf(1, 0);
+    cdf.reserve(pSync.size());
+    NeumaierSum<double> cumulativeProb;
+    NeumaierSum<double> moments[MAX_MOMENT_ORDER];
+    size_t k = 1;
+    while (k <= max_step) {
+        cumulativeProb += pSync.at(k);
+        cdf.push_back(cumulativeProb.value());
+        double term = pSync[k];
+        for (NeumaierSum<double> &moment: moments) {
+            term *= k;
+            moment += term;
+        }
+        k += 1;
     }
 
-    results.avgSyncTime_ = Tavg_sync;
+    for (int r = 0; r < MAX_MOMENT_ORDER; r++) {
+        moments_[r] = moments[r].value();
+    }
 
-    results.cdf_.push_back(0);
-    size_t k = 1;
-    do {
-        results.cdf_.push_back(results.cdf_[k - 1] + Psync(k));
-        k += 1;
-    } while (k <= max_step);
+    cdf_ = CompactCDF(std::move(cdf), tolerance / 10, tailPeriod(syncParams));
 
-    return results;
+    // The rounding error of each probability grows at most linearly with the number of the operations in the products
+    // from which it results, i.e., with the number of steps.
+    const double roundingError = 2 * max_step * epsilon;
+    avgSyncTimeError_ = truncationErrorInAVG + roundingError * avgSyncTime;
+    cdfError_ = truncationErrorInCDF + roundingError + cdf_.error();
+}
+
+size_t M6SS::Model::Results::tailPeriod(const SyncParameters &syncParams) {
+    // Each lane of the calculation uses the channels of W periodically, so its survival decreases by a constant factor
+    // every C scan periods in Cases 1 and 2 and, in Case 3, every C times the steps after which the scan periods are
+    // aligned with the steps again.
+    const long C = syncParams.getCHS().size();
+    const nanoseconds Tsf = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
+    const nanoseconds &Tscan = syncParams.getTScan();
+    if (Tscan < Tsf) {
+        return C;
+    }
+    return Tscan.count() / std::gcd(Tscan.count(), Tsf.count()) * C;
+}
+
+void M6SS::Model::Results::calculateMoments() {
+    NeumaierSum<double> moments[MAX_MOMENT_ORDER];
+    for (size_t k = 1; k < cdf_.size(); k++) {
+        double term = cdf_[k] - cdf_[k - 1];
+        for (NeumaierSum<double> &moment: moments) {
+            term *= k;
+            moment += term;
+        }
+    }
+
+    for (int r = 0; r < MAX_MOMENT_ORDER; r++) {
+        moments_[r] = moments[r].value();
+    }
 }
 
-std::chrono::duration<double> M6SS::Model::Results::avgSyncTime() {
+std::chrono::duration<double> M6SS::Model::Results::avgSyncTime() const {
     return avgSyncTime_;
 }
 
-double M6SS::Model::Results::cdf(size_t steps) {
+std::chrono::duration<double> M6SS::Model::Results::avgSyncTimeError() const {
+    return avgSyncTimeError_;
+}
+
+double M6SS::Model::Results::cdfError() const {
+    return cdfError_;
+}
+
+bool M6SS::Model::Results::isSinglePrecision() const {
+    return singlePrecision_;
+}
+
+double M6SS::Model::Results::cdf(size_t steps) const {
     if (steps < 1) {
         throw std::invalid_argument("steps must be greater than zero.");
     }
@@ -277,4 +700,69 @@ double M6SS::Model::Results::cdf(size_t steps) {
         return 1;
 
     return cdf_[steps];
-}
\ No newline at end of file
+}
+
+size_t M6SS::Model::Results::quantile(double p) const {
+    if (not(p >= 0 and p <= 1)) {
+        throw std::invalid_argument("p must be in the range [0, 1].");
+    }
+
+    // cdf(k) is one after the calculated steps
+    return cdf_.quantile(p);
+}
+
+std::chrono::duration<double> M6SS::Model::Results::quantileTime(double p) const {
+    return quantile(p) * Tsf_ + Teb_;
+}
+
+double M6SS::Model::Results::moment(int order) const {
+    if (order < 1 or order > MAX_MOMENT_ORDER) {
+        throw std::invalid_argument("order must be in the range [1, MAX_MOMENT_ORDER].");
+    }
+
+    return moments_[order - 1];
+}
+
+double M6SS::Model::Results::variance() const {
+    return std::max(0.0, moments_[1] - moments_[0] * moments_[0]);
+}
+
+std::chrono::duration<double> M6SS::Model::Results::syncTimeStdDev() const {
+    return std::sqrt(variance() + 1.0 / 12) * duration<double>(Tsf_);
+}
+
+std::chrono::duration<double> M6SS::Model::Sensitivities::avgSyncTimeByPeb() const {
+    return avgSyncTime_.at(0);
+}
+
+std::chrono::duration<double> M6SS::Model::Sensitivities::avgSyncTimeByPsr(int channel) const {
+    return avgSyncTime_.at(indexOf(channel));
+}
+
+double M6SS::Model::Sensitivities::cdfByPeb(size_t steps) const {
+    return cdfBy(0, steps);
+}
+
+double M6SS::Model::Sensitivities::cdfByPsr(int channel, size_t steps) const {
+    return cdfBy(indexOf(channel), steps);
+}
+
+size_t M6SS::Model::Sensitivities::indexOf(int channel) const {
+    auto it = std::find(chs_.begin(), chs_.end(), channel);
+    if (it == chs_.end()) {
+        throw std::out_of_range("The channel is not included in the channel hopping sequence.");
+    }
+    return it - chs_.begin() + 1;
+}
+
+double M6SS::Model::Sensitivities::cdfBy(size_t variable, size_t steps) const {
+    if (steps < 1) {
+        throw std::invalid_argument("steps must be greater than zero.");
+    }
+
+    const std::vector<double> &cdf = cdf_.at(variable);
+    if (steps >= cdf.size()) // cdf(steps) is 1 after the calculated steps (see Results::cdf)
+        return 0;
+
+    return cdf[steps];
+}
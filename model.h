@@ -19,12 +19,21 @@
 
 #include <chrono>
 #include "syncparameters.h"
+#include "compactcdf.h"
+#include "cancellationtoken.h"
 
 namespace M6SS {
 
+    class ThreadPool; // forward declaration
+    class ParameterBatch; // forward declaration
+    class ModelStore; // forward declaration
+    class ModelSession; // forward declaration
+
     class Model {
     public:
         class Results; // forward declaration
+        class Sensitivities; // forward declaration
+        struct Options; // forward declaration
 
         /**
          * This function calculate the average synchronization time, as well as the cumulative distribution function (cdf)
@@ -38,14 +47,144 @@ namespace M6SS {
          */
         static Results& calculate(const SyncParameters &syncParams, Results &results);
 
+        /**
+         * The same as the function above, but the accuracy of the calculation is controlled by the given options.
+         * @param syncParams the synchronization procedure parameters for which the calculation will be made.
+         * @param results an object of type 'Results' (see below), which contains the results of the calculation.
+         * @param options the options of the calculation (see below).
+         * @return a reference to the Results object
+         * @throw std::invalid_argument if options.tolerance is not in the range (0, 1).
+         * @throw OperationCancelled if options.cancellation is cancelled during the calculation.
+         */
+        static Results& calculate(const SyncParameters &syncParams, Results &results, const Options &options);
+
+        /**
+         * The same as the function above, but it also calculates the derivatives of the results with respect to Peb
+         * and the Psr of each channel (see Sensitivities), in a single pass through forward-mode automatic
+         * differentiation. The calculation is always made in double precision (i.e., options.precision is ignored). The
+         * derivatives are exact (up to rounding) and, in Case 3, which is the most expensive, they cost a few plain
+         * calculations, instead of the 2C + 1 calculations of central finite differences.
+         * @param syncParams the synchronization procedure parameters for which the calculation will be made.
+         * @param results an object of type 'Results' (see below), which contains the results of the calculation.
+         * @param sensitivities an object of type 'Sensitivities' (see below), which contains the derivatives.
+         * @param options the options of the calculation (see below).
+         * @return a reference to the Results object
+         * @throw std::invalid_argument if options.tolerance is not in the range (0, 1).
+         */
+        static Results& calculate(const SyncParameters &syncParams, Results &results, Sensitivities &sensitivities,
+                                  const Options &options);
+
+        /**
+         * The same as the function above, with the default options.
+         */
+        static Results& calculate(const SyncParameters &syncParams, Results &results, Sensitivities &sensitivities);
+
+        /**
+         * Makes the calculation for a set of synchronization parameters in parallel, using the shared thread pool (see
+         * ThreadPool::shared()). The parameter sets are handed out to the threads one at a time (those of Case 3, which
+         * are the most expensive, first), so that the load is balanced.
+         * @param syncParamsSet the parameter sets for which the calculation will be made.
+         * @param results a vector that, on return, contains the results for each parameter set, in the same order.
+         * @param options the options of the calculations.
+         * @return a reference to the results vector
+         * @throw std::invalid_argument if options.tolerance is not in the range (0, 1).
+         */
+        static std::vector<Results>& calculateBatch(const std::vector<SyncParameters> &syncParamsSet,
+                                                    std::vector<Results> &results, const Options &options);
+
+        /**
+         * The same as the function above, but the calculations are made by the given thread pool.
+         */
+        static std::vector<Results>& calculateBatch(const std::vector<SyncParameters> &syncParamsSet,
+                                                    std::vector<Results> &results, const Options &options,
+                                                    ThreadPool &pool);
+
+        /**
+         * Makes the calculation for each parameter set of a batch (see ParameterBatch), using the shared thread pool.
+         * In Cases 1 and 2, the parameter sets are evaluated in blocks of BATCH_BLOCK_SIZE, where each SIMD lane
+         * corresponds to a parameter set (see PsyncBatchKernel). The results are the same as those of calculate(),
+         * except for rounding differences. In Case 3, the parameter sets are evaluated one by one.
+         * @param batch the parameter sets for which the calculation will be made.
+         * @param results a vector that, on return, contains the results for each parameter set, in the same order.
+         * @param options the options of the calculations.
+         * @return a reference to the results vector
+         * @throw std::invalid_argument if options.tolerance is not in the range (0, 1).
+         */
+        static std::vector<Results>& calculateBatch(const ParameterBatch &batch, std::vector<Results> &results,
+                                                    const Options &options);
+
+        /**
+         * The same as the function above, but the calculations are made by the given thread pool.
+         */
+        static std::vector<Results>& calculateBatch(const ParameterBatch &batch, std::vector<Results> &results,
+                                                    const Options &options, ThreadPool &pool);
+
+        /**
+         * The options of a calculation.
+         */
+        struct Options {
+            /**
+             * The termination tolerance of the calculation. In Cases 1 and 2, the calculation stops when the
+             * cumulative probability reaches 1 - tolerance, while in Case 3 the scan periods that are reached with a
+             * probability less than tolerance are not examined further. The default value is suitable for validation
+             * purposes; looser values (e.g., 1e-4) are much faster and are sufficient for interactive exploration.
+             */
+            double tolerance = 1e-9;
+
+            /**
+             * The precision of the probability calculations.
+             */
+            enum class Precision {
+                Double, // all the calculations are made in double precision
+                /* In Cases 1 and 2, the probabilities are calculated in single precision, which doubles the SIMD width,
+                 * and are accumulated in double precision. If the estimated relative rounding error of the results
+                 * exceeds maxMixedPrecisionError, the calculation is repeated in double precision. Case 3, as well as
+                 * tolerances less than MIN_MIXED_PRECISION_TOLERANCE, are always calculated in double precision. */
+                Mixed
+            };
+
+            Precision precision = Precision::Double;
+
+            /**
+             * The maximum relative rounding error of a calculation in mixed precision (see Precision::Mixed).
+             */
+            double maxMixedPrecisionError = 1e-3;
+
+            /**
+             * The minimum tolerance for which the mixed precision is used, since the probabilities in single precision
+             * do not have enough accuracy to reach a tighter cumulative probability.
+             */
+            static constexpr double MIN_MIXED_PRECISION_TOLERANCE = 1e-5;
+
+            /**
+             * The maximum memory (in bytes) of the probabilities of the steps and, in Case 3, of the scan periods
+             * that are pending examination, so that a pathological parameter set (e.g., with very low Psr) cannot
+             * exhaust the memory. If it is reached, the calculation stops as if the tolerance had been reached, and
+             * the rest of the distribution is accounted for in the errors of the results (see
+             * Results::avgSyncTimeError and Results::cdfError). Zero means no limit.
+             */
+            size_t maxMemory = size_t(1) << 30;
+
+            /**
+             * If it is set, the calculation polls the token at regular intervals (every CANCELLATION_POLL_INTERVAL
+             * steps in Cases 1 and 2, and every scan period in Case 3) and throws OperationCancelled once it is
+             * cancelled. The token must outlive the calculation.
+             */
+            const CancellationToken *cancellation = nullptr;
+
+            static constexpr size_t CANCELLATION_POLL_INTERVAL = 4096;
+        };
+
         class Results {
             friend class Model;
+            friend class ModelStore;
+            friend class ModelSession;
 
         public:
             /**
              * Returns the average synchronization time.
              */
-            std::chrono::duration<double> avgSyncTime();
+            std::chrono::duration<double> avgSyncTime() const;
 
             /**
              * This function represents the cumulative distribution function (cdf) of the random variable X that
@@ -54,12 +193,153 @@ namespace M6SS {
              * @return P(X ≤ steps)
              * @throw std::invalid_argument if steps is not greater than zero.
              */
-            double cdf(size_t steps);
+            double cdf(size_t steps) const;
+
+            /**
+             * Returns an upper bound of the absolute error of avgSyncTime() due to the termination of the calculation
+             * and the rounding errors. In Case 3, the synchronization time after a discarded scan period is bounded
+             * through the minimum probability of a synchronization in a scan period (see
+             * ScanPeriodGeometry::discardedTimeBound), so the bound is infinite if that probability is zero.
+             */
+            std::chrono::duration<double> avgSyncTimeError() const;
+
+            /**
+             * Returns an upper bound of the absolute error of cdf(steps), for any steps, due to the termination of the
+             * calculation and the rounding errors.
+             */
+            double cdfError() const;
+
+            /**
+             * Returns true if the probabilities were calculated in single precision (see Options::Precision).
+             */
+            bool isSinglePrecision() const;
+
+            /**
+             * Returns the p-quantile of the number of steps X for the synchronization, i.e., the minimum number of
+             * steps k for which cdf(k) ≥ p. The search is a binary search over the cdf, which is non-decreasing.
+             * @param p the probability, in the range [0, 1].
+             * @return the minimum k ≥ 1 for which cdf(k) ≥ p.
+             * @throw std::invalid_argument if p is not in the range [0, 1].
+             */
+            size_t quantile(double p) const;
+
+            /**
+             * Returns an upper bound of the p-quantile of the synchronization time, i.e., quantile(p) * Tsf + Teb,
+             * since a synchronization in the step k ends at most at k * Tsf + Teb.
+             * @param p the probability, in the range [0, 1].
+             * @throw std::invalid_argument if p is not in the range [0, 1].
+             */
+            std::chrono::duration<double> quantileTime(double p) const;
+
+            /**
+             * Returns the raw moment E[X^order] of the number of steps X for the synchronization. The moments are
+             * accumulated together with the cdf and, like it, they do not include the probability beyond the
+             * calculated steps (see cdfError()).
+             * @param order the order of the moment, in the range [1, MAX_MOMENT_ORDER].
+             * @throw std::invalid_argument if order is not in the range [1, MAX_MOMENT_ORDER].
+             */
+            double moment(int order) const;
+
+            /**
+             * Returns the variance of the number of steps X for the synchronization.
+             */
+            double variance() const;
+
+            /**
+             * Returns the standard deviation of the synchronization time, i.e., Tsf * sqrt(variance() + 1/12), since
+             * the scan starts at a uniformly distributed time within the step in which the synchronization occurs (in
+             * Case 3, this is an approximation).
+             */
+            std::chrono::duration<double> syncTimeStdDev() const;
+
+            static constexpr int MAX_MOMENT_ORDER = 4;
 
         private:
+            /**
+             * Sets the results of a calculation.
+             * @param avgSyncTime the average synchronization time.
+             * @param pSync an array with Psync(k) for k = 1, 2, ..., where the first element (k = 0) is ignored.
+             * @param truncationErrorInAVG, truncationErrorInCDF the errors due to the termination of the calculation.
+             * @param epsilon the machine epsilon of the calculation of the probabilities.
+             * @param syncParams the parameters of the calculation.
+             * @param tolerance the tolerance of the calculation; the cdf is stored in a compact form (see CompactCDF)
+             * with an error of at most tolerance / 10.
+             */
+            void assign(std::chrono::duration<double> avgSyncTime, const std::vector<double> &pSync,
+                        std::chrono::duration<double> truncationErrorInAVG, double truncationErrorInCDF,
+                        double epsilon, const SyncParameters &syncParams, double tolerance);
+
+            /**
+             * Returns the period of the tail of the cdf for the given parameters, in steps (see CompactCDF).
+             */
+            static size_t tailPeriod(const SyncParameters &syncParams);
+
+            /**
+             * Calculates the moments from the cdf (e.g., for results that are loaded from a ModelStore).
+             */
+            void calculateMoments();
+
             std::chrono::duration<double> avgSyncTime_;
-            std::vector<double> cdf_;
+            CompactCDF cdf_;
+            std::chrono::duration<double> avgSyncTimeError_;
+            double cdfError_;
+            bool singlePrecision_;
+            std::chrono::nanoseconds Tsf_;
+            std::chrono::nanoseconds Teb_;
+            double moments_[MAX_MOMENT_ORDER]; // E[X^r] for r = 1, ..., MAX_MOMENT_ORDER
         };
+
+        /**
+         * The derivatives of the results of the model with respect to Peb and the Psr of each channel.
+         */
+        class Sensitivities {
+            friend class Model;
+
+        public:
+            /**
+             * Returns the derivative of the average synchronization time with respect to Peb.
+             */
+            std::chrono::duration<double> avgSyncTimeByPeb() const;
+
+            /**
+             * Returns the derivative of the average synchronization time with respect to the Psr of a channel.
+             * @param channel the channel.
+             * @throw std::out_of_range if the channel is not included in the channel hopping sequence.
+             */
+            std::chrono::duration<double> avgSyncTimeByPsr(int channel) const;
+
+            /**
+             * Returns the derivative of cdf(steps) (see Results) with respect to Peb.
+             * @param steps the number of steps.
+             * @throw std::invalid_argument if steps is not greater than zero.
+             */
+            double cdfByPeb(size_t steps) const;
+
+            /**
+             * Returns the derivative of cdf(steps) (see Results) with respect to the Psr of a channel.
+             * @param channel the channel.
+             * @param steps the number of steps.
+             * @throw std::out_of_range if the channel is not included in the channel hopping sequence.
+             * @throw std::invalid_argument if steps is not greater than zero.
+             */
+            double cdfByPsr(int channel, size_t steps) const;
+
+        private:
+            /* Returns the index of the variable that corresponds to the Psr of a channel. */
+            size_t indexOf(int channel) const;
+
+            /* Returns the derivative of cdf(steps) with respect to a variable. */
+            double cdfBy(size_t variable, size_t steps) const;
+
+            std::vector<int> chs_;
+            // for each variable, i.e., Peb (index 0) and the Psr of each channel chs_[i] (index i + 1)
+            std::vector<std::chrono::duration<double> > avgSyncTime_;
+            std::vector<std::vector<double> > cdf_;
+        };
+
+    private:
+        /* the number of the parameter sets of a ParameterBatch that are evaluated together */
+        static constexpr size_t BATCH_BLOCK_SIZE = 256;
     };
 }
 
@@ -0,0 +1,112 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include "modelcache.h"
+
+M6SS::ModelCache::ModelCache(size_t capacity, const Model::Options &options, int numShards) : options_(options) {
+    if (capacity < 1) {
+        throw std::invalid_argument("capacity must be greater than zero.");
+    }
+
+    if (numShards < 1) {
+        throw std::invalid_argument("numShards must be greater than zero.");
+    }
+
+    shardCapacity_ = (capacity + numShards - 1) / numShards;
+    shards_ = std::vector<Shard>(numShards);
+}
+
+std::shared_ptr<const M6SS::Model::Results> M6SS::ModelCache::get(const SyncParameters &syncParams) {
+    std::shared_ptr<const Model::Results> results = find(syncParams);
+    if (results) {
+        return results;
+    }
+
+    auto calculated = std::make_shared<Model::Results>();
+    Model::calculate(syncParams, *calculated, options_);
+    put(syncParams, calculated);
+    return calculated;
+}
+
+std::shared_ptr<const M6SS::Model::Results> M6SS::ModelCache::find(const SyncParameters &syncParams) {
+    Shard &shard = shardOf(syncParams);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    auto it = shard.index.find(syncParams);
+    if (it == shard.index.end()) {
+        misses_++;
+        return nullptr;
+    }
+
+    hits_++;
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second); // mark as the most recently used
+    return it->second->second;
+}
+
+void M6SS::ModelCache::put(const SyncParameters &syncParams, std::shared_ptr<const Model::Results> results) {
+    Shard &shard = shardOf(syncParams);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+
+    auto it = shard.index.find(syncParams);
+    if (it != shard.index.end()) {
+        it->second->second = std::move(results);
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+
+    shard.entries.emplace_front(syncParams, std::move(results));
+    shard.index.emplace(syncParams, shard.entries.begin());
+
+    if (shard.entries.size() > shardCapacity_) { // evict the least recently used results
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+}
+
+void M6SS::ModelCache::clear() {
+    for (Shard &shard: shards_) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+}
+
+size_t M6SS::ModelCache::size() const {
+    size_t size = 0;
+    for (const Shard &shard: shards_) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+long M6SS::ModelCache::hits() const {
+    return hits_;
+}
+
+long M6SS::ModelCache::misses() const {
+    return misses_;
+}
+
+const M6SS::Model::Options &M6SS::ModelCache::getOptions() const {
+    return options_;
+}
+
+M6SS::ModelCache::Shard &M6SS::ModelCache::shardOf(const SyncParameters &syncParams) {
+    // the high bits select the shard, since the low bits select the bucket of the index of the shard
+    return shards_[(syncParams.hash() >> 32) % shards_.size()];
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_MODELCACHE_H
+#define M6SS_MODELCACHE_H
+
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "syncparameters.h"
+#include "model.h"
+
+namespace M6SS {
+
+    /**
+     * This class represents a thread-safe cache of the results of the model, keyed by the synchronization parameters
+     * (see SyncParameters::hash). The cache is split in shards, each one with its own lock, so that concurrent lookups
+     * rarely contend, and each shard evicts its least recently used results when it is full.
+     */
+    class ModelCache {
+    public:
+        /**
+         * Initializes a new instance of the ModelCache class.
+         * @param capacity the maximum number of results that are kept.
+         * @param options the options of the calculations that are made on cache misses.
+         * @param numShards the number of shards.
+         * @throw std::invalid_argument if capacity or numShards is less than 1.
+         */
+        explicit ModelCache(size_t capacity, const Model::Options &options = Model::Options(), int numShards = 16);
+
+        /**
+         * Returns the results of the model for the given parameters. If they are not in the cache, the calculation
+         * is made (without holding any lock, so that other lookups are not blocked) and the results are cached.
+         * It is noted that two threads that miss the same parameters at the same time may both make the calculation.
+         * @param syncParams the synchronization parameters.
+         * @return the results of the model.
+         */
+        std::shared_ptr<const Model::Results> get(const SyncParameters &syncParams);
+
+        /**
+         * Returns the results of the model for the given parameters, if they are in the cache.
+         * @param syncParams the synchronization parameters.
+         * @return the results of the model, or nullptr if they are not in the cache.
+         */
+        std::shared_ptr<const Model::Results> find(const SyncParameters &syncParams);
+
+        /**
+         * Adds the results of the model for the given parameters to the cache.
+         * @param syncParams the synchronization parameters.
+         * @param results the results of the model for syncParams, calculated with the options of the cache.
+         */
+        void put(const SyncParameters &syncParams, std::shared_ptr<const Model::Results> results);
+
+        /**
+         * Removes all the results from the cache. The counters are not reset.
+         */
+        void clear();
+
+        /**
+         * Returns the number of results in the cache.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Returns the number of lookups that found the results in the cache.
+         */
+        [[nodiscard]] long hits() const;
+
+        /**
+         * Returns the number of lookups that did not find the results in the cache.
+         */
+        [[nodiscard]] long misses() const;
+
+        /**
+         * Returns the options of the calculations made by the cache.
+         */
+        [[nodiscard]] const Model::Options &getOptions() const;
+
+    private:
+        struct Shard {
+            using Entry = std::pair<SyncParameters, std::shared_ptr<const Model::Results> >;
+
+            mutable std::mutex mutex;
+            std::list<Entry> entries; // the most recently used first
+            std::unordered_map<SyncParameters, std::list<Entry>::iterator> index;
+        };
+
+        Shard &shardOf(const SyncParameters &syncParams);
+
+        Model::Options options_;
+        size_t shardCapacity_;
+        std::vector<Shard> shards_;
+        std::atomic<long> hits_{0};
+        std::atomic<long> misses_{0};
+    };
+
+}
+
+#endif //M6SS_MODELCACHE_H
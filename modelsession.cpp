@@ -0,0 +1,329 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "modelsession.h"
+#include "scanperiodgeometry.h"
+
+using std::chrono::duration, std::chrono::nanoseconds;
+using namespace std::chrono_literals;
+
+M6SS::ModelSession::ModelSession(const SyncParameters &syncParams, const Model::Options &options)
+        : syncParams_(syncParams), options_(options) {
+    if (not(options.tolerance > 0 and options.tolerance < 1)) {
+        throw std::invalid_argument("tolerance must be in the range (0, 1).");
+    }
+
+    reset(syncParams);
+}
+
+const M6SS::Model::Results &M6SS::ModelSession::setPeb(double pEB) {
+    syncParams_ = SyncParameters(syncParams_.getCHS(), syncParams_.getS(), pEB, syncParams_.getPsr(),
+                                 syncParams_.getTScan(), syncParams_.getTSwitch(), syncParams_.getTeb());
+    if (case3_) {
+        for (int w = 0; w < C_; w++) {
+            refreshChannel(w);
+        }
+    }
+    recalculate();
+    return results_;
+}
+
+const M6SS::Model::Results &M6SS::ModelSession::setPsr(int channel, double pSR) {
+    auto w = std::find(W_.begin(), W_.end(), channel);
+    if (w == W_.end()) {
+        throw std::invalid_argument("The channel is not included in the channel hopping sequence.");
+    }
+
+    std::map<int, double> Psr = syncParams_.getPsr();
+    Psr[channel] = pSR;
+    syncParams_ = SyncParameters(syncParams_.getCHS(), syncParams_.getS(), syncParams_.getPeb(), Psr,
+                                 syncParams_.getTScan(), syncParams_.getTSwitch(), syncParams_.getTeb());
+    if (case3_) {
+        refreshChannel(w - W_.begin());
+    }
+    recalculate();
+    return results_;
+}
+
+const M6SS::Model::Results &M6SS::ModelSession::update(const SyncParameters &syncParams) {
+    if (syncParams.getCHS() != syncParams_.getCHS() or syncParams.getS() != syncParams_.getS() or
+        syncParams.getTScan() != syncParams_.getTScan() or syncParams.getTeb() != syncParams_.getTeb()) {
+        syncParams_ = syncParams;
+        reset(syncParams);
+        return results_;
+    }
+
+    syncParams_ = syncParams;
+    if (case3_) {
+        for (int w = 0; w < C_; w++) {
+            refreshChannel(w);
+        }
+    }
+    recalculate();
+    return results_;
+}
+
+const M6SS::Model::Results &M6SS::ModelSession::getResults() const {
+    return results_;
+}
+
+const M6SS::SyncParameters &M6SS::ModelSession::getSyncParameters() const {
+    return syncParams_;
+}
+
+size_t M6SS::ModelSession::getNumNodes() const {
+    return nodes_.size();
+}
+
+void M6SS::ModelSession::reset(const SyncParameters &syncParams) {
+    const std::vector<int> &chs = syncParams.getCHS();
+    C_ = chs.size();
+    Tsf_ = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
+    case3_ = syncParams.getTScan() > Tsf_ and syncParams.getTScan() % Tsf_ != 0ns;
+
+    W_.clear();
+    for (int i = 1; i <= C_; i++) {
+        // note that both the slotOffset and the channelOffset of the minimal cell are zero
+        W_.push_back(chs[((i - 1) * syncParams.getS()) % C_]);
+    }
+
+    nodes_.clear();
+    steps_.clear();
+    pStepW_.assign(C_, 0);
+    pNoReceptionW_.assign(C_, 0);
+    powers_.assign(C_, std::vector<double>(1, 1));
+    maxExponent_ = 0;
+
+    if (case3_) {
+        for (int y = 0; y < C_; y++) {
+            Node root;
+            root.i = 1;
+            root.I = TimeInterval(0ns, Tsf_);
+            root.y = y;
+            nodes_.push_back(root);
+        }
+
+        for (int w = 0; w < C_; w++) {
+            refreshChannel(w);
+        }
+    }
+
+    recalculate();
+}
+
+void M6SS::ModelSession::refreshChannel(int w) {
+    // the same expressions as in Model::calculate, so that the results are the same
+    const double Peb = syncParams_.getPeb();
+    const double Psr = syncParams_.getPsr().at(W_[w]);
+    pStepW_[w] = 1.0 / C_ * Peb * Psr;
+    pNoReceptionW_[w] = 1 - Peb * Psr;
+
+    std::vector<double> &powers = powers_[w];
+    powers.resize(maxExponent_ + 1);
+    for (size_t e = 0; e <= maxExponent_; e++) {
+        powers[e] = std::pow(pNoReceptionW_[w], e);
+    }
+}
+
+void M6SS::ModelSession::recalculate() {
+    if (not case3_) {
+        Model::calculate(syncParams_, results_, options_);
+        return;
+    }
+
+    pSync_.assign(1, 0);
+    discardedProb_ = NeumaierSum<double>();
+    discardedStartTime_ = NeumaierSum<double>();
+
+    // the scan periods are replayed level by level, in the same order as in Model::calculate
+    std::vector<std::pair<size_t, double> > level, nextLevel; // the index of a node and its probability
+    for (int y = 0; y < C_; y++) {
+        level.emplace_back(y, 1.0);
+    }
+
+    std::vector<NeumaierSum<double> > laneSums(C_); // the expected value of each lane, in seconds
+    for (size_t i = 1; not level.empty(); i++) {
+        if (options_.maxMemory > 0 and (pSync_.capacity() + level.capacity() + nextLevel.capacity()) * sizeof(double) +
+                                       nodes_.capacity() * sizeof(Node) + steps_.capacity() * sizeof(Step) >
+                                       options_.maxMemory) {
+            // the memory cap is reached; the remaining scan periods are discarded
+            for (const auto &[index, q]: level) {
+                discardedProb_ += 1.0 / C_ * q;
+                discardedStartTime_ += 1.0 / C_ * q * duration<double>((i - 1) * syncParams_.getTScan()).count();
+            }
+            break;
+        }
+
+        for (const auto &[index, q]: level) {
+            replay(index, q, laneSums[nodes_[index].y], nextLevel);
+        }
+        level.swap(nextLevel);
+        nextLevel.clear();
+    }
+
+    NeumaierSum<double> sum; // in seconds
+    for (int y = 0; y < C_; y++) {
+        sum += 1.0 / C_ * laneSums[y].value();
+    }
+    const double Tavg_sync = sum.value();
+
+    const duration<double> truncationErrorInAVG = ScanPeriodGeometry::discardedTimeBound(
+            syncParams_.getTScan(), Tsf_, syncParams_.getTeb(), pStepW_, discardedProb_.value(),
+            duration<double>(discardedStartTime_.value()));
+    results_.singlePrecision_ = false;
+    results_.assign(duration<double>(Tavg_sync), pSync_, truncationErrorInAVG, discardedProb_.value(),
+                    std::numeric_limits<double>::epsilon(), syncParams_, options_.tolerance);
+}
+
+void M6SS::ModelSession::expand(size_t index) {
+    const int C = C_;
+    const size_t i = nodes_[index].i;
+    const int y = nodes_[index].y;
+
+    // the geometry of the scan period, as in Case 3 of Model::calculate
+    const ScanPeriodGeometry geometry(syncParams_.getTScan(), Tsf_, syncParams_.getTeb(), C, i, y, nodes_[index].I);
+    const size_t k_f = geometry.firstStep();
+    const size_t k_l = geometry.lastStep();
+
+    const size_t firstStep = steps_.size();
+    steps_.push_back(Step{geometry.channel(k_f), 0, geometry.time(k_f).count()});
+    for (size_t k = k_f + 1; k <= k_l; k++) {
+        steps_.push_back(Step{geometry.channel(k), geometry.exponent(k), geometry.time(k).count()});
+    }
+
+    // extend the tables of the powers, if the new steps need higher exponents
+    size_t maxExponent = maxExponent_;
+    for (size_t s = firstStep + 1; s < steps_.size(); s++) {
+        maxExponent = std::max(maxExponent, steps_[s].exponent);
+    }
+    if (maxExponent > maxExponent_) {
+        maxExponent_ = maxExponent;
+        for (int w = 0; w < C; w++) {
+            refreshChannel(w);
+        }
+    }
+
+    Node &node = nodes_[index];
+    node.k_f = k_f;
+    node.k_l = k_l;
+    node.coversFirstStep = geometry.coversFirstStep();
+    node.Plsc = geometry.lastStepCoverage();
+    node.ncFraction = geometry.notCoveredFraction();
+    node.firstStep = firstStep;
+    node.expanded = true;
+
+    // the next scan periods; those with an empty interval do not contribute
+    long childC = -1, childNC = -1;
+    if (not geometry.coveredNext().isEmpty()) {
+        Node child;
+        child.i = i + 1;
+        child.I = geometry.coveredNext();
+        child.y = y;
+        childC = nodes_.size();
+        nodes_.push_back(child);
+    }
+    if (not geometry.notCoveredNext().isEmpty()) {
+        Node child;
+        child.i = i + 1;
+        child.I = geometry.notCoveredNext();
+        child.y = y;
+        childNC = nodes_.size();
+        nodes_.push_back(child);
+    }
+    nodes_[index].childC = childC;
+    nodes_[index].childNC = childNC;
+}
+
+void M6SS::ModelSession::replay(size_t index, double q, NeumaierSum<double> &res,
+                                std::vector<std::pair<size_t, double> > &nextLevel) {
+    // This mirrors the examination of a scan period of Case 3 in Model::calculate, operation by operation, so that the
+    // results are the same. Note that nodes_ and steps_ may grow during the expansion, so it precedes any references.
+    const int C = C_;
+
+    if (q < options_.tolerance) {
+        discardedProb_ += 1.0 / C * q;
+        discardedStartTime_ += 1.0 / C * q *
+                               duration<double>((nodes_[index].i - 1) * syncParams_.getTScan()).count();
+        return;
+    }
+
+    if (not nodes_[index].expanded) {
+        expand(index);
+    }
+
+    auto updatePSync = [this](size_t k, double p) {
+        if (k >= pSync_.size()) {
+            pSync_.push_back(p);
+        } else {
+            pSync_[k] += p;
+        }
+    };
+
+    // the contribution (in seconds) of a synchronization with probability p at the time t (in nanoseconds)
+    auto E = [](double p, double t) {
+        return p * t / 1e9;
+    };
+
+    const Node &node = nodes_[index];
+    const Step *steps = &steps_[node.firstStep];
+    const size_t numInter = node.k_l - node.k_f - 1; // the number of the steps between the first and the last
+
+    auto Pstep_inter = [&](size_t s) {
+        return powers_[steps[s].w][steps[s].exponent] * pStepW_[steps[s].w];
+    };
+
+    double Pstep_first = node.coversFirstStep ? pStepW_[steps[0].w] : double(0);
+    double Psync_first = q * Pstep_first;
+    double E_first = E(Psync_first, steps[0].time);
+
+    const Step &last = steps[numInter + 1];
+    double Pstep_last = powers_[last.w][last.exponent] * pStepW_[last.w];
+    double Psync_last = q * node.Plsc * Pstep_last;
+    double Elast = node.childC >= 0 ? E(Psync_last, last.time) : double(0);
+
+    double sum_p_inter_step = 0;
+    for (size_t s = 1; s <= numInter; s++) {
+        sum_p_inter_step += Pstep_inter(s);
+    }
+
+    double Q_C = q * node.Plsc * (1 - (Pstep_first + Pstep_last + sum_p_inter_step));
+    double Q_NC = q * node.ncFraction * (1 - (Pstep_first + sum_p_inter_step));
+
+    res += E_first;
+    updatePSync(node.k_f, 1.0 / C * Psync_first);
+
+    for (size_t s = 1; s <= numInter; s++) {
+        double Psync_inter = q * Pstep_inter(s);
+        res += E(Psync_inter, steps[s].time);
+        updatePSync(node.k_f + s, 1.0 / C * Psync_inter);
+    }
+
+    res += Elast;
+
+    updatePSync(node.k_l, 1.0 / C * Psync_last);
+
+    if (node.childC >= 0) {
+        nextLevel.emplace_back(node.childC, Q_C);
+    }
+
+    if (node.childNC >= 0) {
+        nextLevel.emplace_back(node.childNC, Q_NC);
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_MODELSESSION_H
+#define M6SS_MODELSESSION_H
+
+#include <vector>
+#include <utility>
+#include <chrono>
+#include "syncparameters.h"
+#include "model.h"
+#include "timeinterval.h"
+#include "compensatedsum.h"
+
+namespace M6SS {
+
+    /**
+     * This class represents a model calculation that is kept up to date while Peb or the Psr of individual channels
+     * change (e.g., in a what-if analysis), without starting from scratch on each change.
+     *
+     * In Case 3, the structure of the examination of the scan periods (i.e., the scan periods, the intervals of the EB
+     * point and the steps of each scan period, together with the channels and the exponents of (1 - Peb * Psr) that
+     * they use) depends only on Tscan, Tsf and Teb. The session records this structure once, as a tree, and on each
+     * change it only refreshes the probabilities of the affected channels (Pstep and the powers of 1 - Peb * Psr) and
+     * replays the tree level by level. Subtrees that were not reached before, since their probability was below the
+     * tolerance, are recorded when they are first reached. The results are the same as those of Model::calculate,
+     * except for rounding differences (e.g., when the compiler fuses multiplications and additions differently), and
+     * except when the memory cap is reached (see Model::Options::maxMemory), since the recorded tree is counted too.
+     *
+     * In Cases 1 and 2, the calculation is already a single pass over the steps (see PsyncKernel), whose cost is
+     * comparable to that of the update of the tables, so each change makes a full calculation.
+     */
+    class ModelSession {
+    public:
+        /**
+         * Initializes a new session and makes the calculation for the given parameters.
+         * @param syncParams the synchronization parameters.
+         * @param options the options of the calculations.
+         * @throw std::invalid_argument if options.tolerance is not in the range (0, 1).
+         */
+        explicit ModelSession(const SyncParameters &syncParams, const Model::Options &options = Model::Options());
+
+        /**
+         * Changes Peb and updates the results.
+         * @param pEB the new probability of an EB transmission.
+         * @return the updated results.
+         * @throw std::invalid_argument if pEB is not a valid probability.
+         */
+        const Model::Results &setPeb(double pEB);
+
+        /**
+         * Changes the Psr of a channel and updates the results.
+         * @param channel the channel, which must be included in the channel hopping sequence.
+         * @param pSR the new probability of a successful reception on the channel.
+         * @return the updated results.
+         * @throw std::invalid_argument if the channel is not in the channel hopping sequence, or, if pSR is not a
+         * valid probability.
+         */
+        const Model::Results &setPsr(int channel, double pSR);
+
+        /**
+         * Changes the parameters and updates the results. If only Peb and the Psr values differ from the current
+         * parameters, the recorded structure is reused, otherwise the session starts from scratch.
+         * @param syncParams the new synchronization parameters.
+         * @return the updated results.
+         */
+        const Model::Results &update(const SyncParameters &syncParams);
+
+        /**
+         * Returns the results for the current parameters.
+         */
+        [[nodiscard]] const Model::Results &getResults() const;
+
+        /**
+         * Returns the current parameters.
+         */
+        [[nodiscard]] const SyncParameters &getSyncParameters() const;
+
+        /**
+         * Returns the number of the scan periods recorded in the tree (zero in Cases 1 and 2), which determines the
+         * memory used by the session.
+         */
+        [[nodiscard]] size_t getNumNodes() const;
+
+    private:
+        /* A step of a scan period: the channel that it uses (as an index in W) and the time of an EB received in it. */
+        struct Step {
+            int w;
+            size_t exponent; // the exponent of (1 - Peb * Psr) in the probability of the step (for all but the first)
+            double time; // in nanoseconds
+        };
+
+        /* A scan period of Case 3 (see Model::calculate), for a lane y and an interval I. */
+        struct Node {
+            size_t i;
+            TimeInterval I;
+            int y;
+            bool expanded = false; // if false, the following members have not been set yet
+            size_t k_f, k_l;
+            bool coversFirstStep;
+            double Plsc; // the probability that the last step is covered
+            double ncFraction; // the probability that the EB point is not covered by the next scan period
+            size_t firstStep; // the index in steps_ of the step k_f, followed by the steps up to k_l
+            long childC = -1, childNC = -1; // the indices of the next scan periods in nodes_, or -1 if there are none
+        };
+
+        void reset(const SyncParameters &syncParams);
+
+        void refreshChannel(int w);
+
+        void recalculate();
+
+        void expand(size_t index);
+
+        void replay(size_t index, double q, NeumaierSum<double> &res,
+                    std::vector<std::pair<size_t, double> > &nextLevel);
+
+        SyncParameters syncParams_;
+        Model::Options options_;
+        Model::Results results_;
+        bool case3_;
+
+        int C_;
+        std::chrono::nanoseconds Tsf_;
+        std::vector<int> W_;
+        std::vector<double> pStepW_, pNoReceptionW_; // for each channel of W
+        std::vector<std::vector<double> > powers_; // (1 - Peb * Psr)^e for each channel of W and exponent e
+        size_t maxExponent_;
+
+        std::vector<Node> nodes_; // the first C nodes are the roots (i = 1) of the lanes y = 0, ..., C-1
+        std::vector<Step> steps_;
+
+        // the state of a replay
+        std::vector<double> pSync_;
+        NeumaierSum<double> discardedProb_, discardedStartTime_; // the discarded scan periods (see Model::calculate)
+    };
+
+}
+
+#endif //M6SS_MODELSESSION_H
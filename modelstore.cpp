@@ -0,0 +1,457 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "modelstore.h"
+
+/* The layout of the file is: a FileHeader, followed by the records. Each record consists of a RecordHeader and the
+ * payload, i.e., the parameters (s, tScan, tSwitch, tEB, pEB, the Psr and the channels in the order of chs) and the
+ * cdf in 32-bit fixed point, padded to a multiple of 8 bytes. All the values are stored in the native byte order. */
+struct M6SS::ModelStore::FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint64_t reserved[3];
+};
+
+struct M6SS::ModelStore::RecordHeader {
+    std::uint32_t state; // COMMITTED when the record has been completely written
+    std::uint32_t size; // the size of the record (including the header) in bytes
+    std::uint64_t hash; // the hash of the parameters
+    std::uint64_t checksum; // the checksum of the record, except for the state and the checksum (see checksum)
+    double tolerance; // the tolerance of the calculation
+    double avgSyncTime; // in seconds
+    double avgSyncTimeError; // in seconds
+    double cdfError;
+    std::uint32_t numChannels;
+    std::uint32_t cdfSize; // the number of the stored cdf values, i.e., for steps 1, 2, ..., cdfSize
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+namespace {
+    constexpr char MAGIC[8] = {'M', '6', 'S', 'S', 'S', 'T', 'O', 'R'};
+    constexpr std::uint32_t VERSION = 2; // version 1 did not cover the header with the checksum
+    constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr std::uint32_t COMMITTED = 0x4d36524b;
+    constexpr std::uint32_t SINGLE_PRECISION_FLAG = 1;
+
+    /* the cdf values are stored as round(value * FIXED_POINT_ONE) */
+    constexpr double FIXED_POINT_ONE = 4294967295.0;
+    /* an upper bound of the absolute error of a cdf value due to the fixed point representation */
+    constexpr double QUANTIZATION_ERROR = 1 / FIXED_POINT_ONE;
+
+    std::uint64_t hashWords(const unsigned char *data, size_t size, std::uint64_t h = 0xcbf29ce484222325ULL) {
+        // size is a multiple of 8
+        for (size_t i = 0; i < size; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ word) * 0x100000001b3ULL;
+            h ^= h >> 29;
+        }
+        return h;
+    }
+
+    void writeAll(int fd, const void *data, size_t size, off_t offset) {
+        auto bytes = static_cast<const unsigned char *>(data);
+        while (size > 0) {
+            ssize_t written = pwrite(fd, bytes, size, offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Fail to write to the store: ") + std::strerror(errno));
+            }
+            bytes += written;
+            size -= written;
+            offset += written;
+        }
+    }
+
+    /* Holds the advisory lock of the file, which serializes the appends of all the processes. */
+    class FileLock {
+    public:
+        explicit FileLock(int fd) : fd_(fd) {
+            while (flock(fd_, LOCK_EX) != 0) {
+                if (errno != EINTR) {
+                    throw std::runtime_error(std::string("Fail to lock the store: ") + std::strerror(errno));
+                }
+            }
+        }
+
+        ~FileLock() {
+            flock(fd_, LOCK_UN);
+        }
+
+    private:
+        int fd_;
+    };
+
+    size_t fileSize(int fd) {
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            throw std::runtime_error(std::string("Fail to access the store: ") + std::strerror(errno));
+        }
+        return st.st_size;
+    }
+}
+
+M6SS::ModelStore::ModelStore(const std::string &path, const Model::Options &options) : path_(path),
+                                                                                         options_(options) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Fail to open the store " + path + ": " + std::strerror(errno));
+    }
+
+    try {
+        FileLock lock(fd_);
+
+        FileHeader header{};
+        if (fileSize(fd_) == 0) { // a new store
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.byteOrder = BYTE_ORDER_MARK;
+            writeAll(fd_, &header, sizeof(header), 0);
+        } else if (pread(fd_, &header, sizeof(header), 0) != sizeof(header) or
+                   std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 or header.version != VERSION or
+                   header.byteOrder != BYTE_ORDER_MARK) {
+            throw std::runtime_error("The file " + path + " is not a (compatible) store.");
+        }
+
+        indexedEnd_ = sizeof(FileHeader);
+        remapAndIndex();
+    } catch (...) {
+        if (map_ != nullptr) {
+            munmap(const_cast<unsigned char *>(map_), mapSize_);
+        }
+        close(fd_);
+        throw;
+    }
+}
+
+M6SS::ModelStore::~ModelStore() {
+    if (map_ != nullptr) {
+        munmap(const_cast<unsigned char *>(map_), mapSize_);
+    }
+    close(fd_);
+}
+
+bool M6SS::ModelStore::find(const SyncParameters &syncParams, Model::Results &results) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (lookup(syncParams, &results)) {
+            return true;
+        }
+    }
+
+    if (refresh()) { // another process may have appended the results
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return lookup(syncParams, &results);
+    }
+    return false;
+}
+
+M6SS::Model::Results &M6SS::ModelStore::get(const SyncParameters &syncParams, Model::Results &results) {
+    if (!find(syncParams, results)) {
+        Model::calculate(syncParams, results, options_);
+        put(syncParams, results);
+    }
+    return results;
+}
+
+std::vector<M6SS::Model::Results> &M6SS::ModelStore::getBatch(const std::vector<SyncParameters> &syncParamsSet,
+                                                              std::vector<Model::Results> &results) {
+    results.resize(syncParamsSet.size());
+
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < syncParamsSet.size(); i++) {
+        if (!find(syncParamsSet[i], results[i])) {
+            missing.push_back(i);
+        }
+    }
+
+    if (missing.empty()) {
+        return results;
+    }
+
+    std::vector<SyncParameters> missingParams;
+    missingParams.reserve(missing.size());
+    for (size_t i: missing) {
+        missingParams.push_back(syncParamsSet[i]);
+    }
+
+    std::vector<Model::Results> missingResults;
+    Model::calculateBatch(missingParams, missingResults, options_);
+
+    std::vector<const SyncParameters *> paramsToAppend;
+    std::vector<const Model::Results *> resultsToAppend;
+    for (size_t j = 0; j < missing.size(); j++) {
+        results[missing[j]] = missingResults[j];
+        paramsToAppend.push_back(&missingParams[j]);
+        resultsToAppend.push_back(&missingResults[j]);
+    }
+    append(paramsToAppend, resultsToAppend);
+
+    return results;
+}
+
+void M6SS::ModelStore::put(const SyncParameters &syncParams, const Model::Results &results) {
+    append({&syncParams}, {&results});
+}
+
+size_t M6SS::ModelStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return index_.size();
+}
+
+const std::string &M6SS::ModelStore::getPath() const {
+    return path_;
+}
+
+bool M6SS::ModelStore::refresh() {
+    size_t size = fileSize(fd_);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (size == mapSize_ and indexedEnd_ == mapSize_) {
+            return false;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    size_t numRecords = index_.size();
+    remapAndIndex();
+    return index_.size() > numRecords;
+}
+
+void M6SS::ModelStore::remapAndIndex() {
+    size_t size = fileSize(fd_);
+    if (size != mapSize_) {
+        if (map_ != nullptr) {
+            munmap(const_cast<unsigned char *>(map_), mapSize_);
+            map_ = nullptr;
+            mapSize_ = 0;
+        }
+
+        void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error(std::string("Fail to map the store: ") + std::strerror(errno));
+        }
+        map_ = static_cast<const unsigned char *>(map);
+        mapSize_ = size;
+    }
+
+    // Index the complete records. An incomplete record is either being written by another process, so it will be
+    // indexed later, or it was left by a crash, so it will be discarded by the next append.
+    size_t offset = indexedEnd_;
+    while (offset + sizeof(RecordHeader) <= mapSize_) {
+        RecordHeader header{};
+        std::memcpy(&header, map_ + offset, sizeof(header));
+        if (header.state != COMMITTED or header.size < sizeof(RecordHeader) or header.size % 8 != 0 or
+            offset + header.size > mapSize_) {
+            break;
+        }
+        index_.emplace(header.hash, offset);
+        offset += header.size;
+    }
+    indexedEnd_ = offset;
+}
+
+bool M6SS::ModelStore::lookup(const SyncParameters &syncParams, Model::Results *results) const {
+    const std::vector<int> &chs = syncParams.getCHS();
+    const std::map<int, double> &pSR = syncParams.getPsr();
+
+    auto range = index_.equal_range(syncParams.hash());
+    for (auto it = range.first; it != range.second; ++it) {
+        const unsigned char *record = map_ + it->second;
+        RecordHeader header{};
+        std::memcpy(&header, record, sizeof(header));
+
+        if (header.tolerance > options_.tolerance or
+            ((header.flags & SINGLE_PRECISION_FLAG) and options_.precision != Model::Options::Precision::Mixed) or
+            header.numChannels != chs.size()) {
+            continue;
+        }
+
+        // a corrupted record is skipped before its payload is decoded, so that it is never read past its end
+        const unsigned char *payload = record + sizeof(RecordHeader);
+        if (header.size != recordSize(header.numChannels, header.cdfSize) or
+            checksum(header, payload) != header.checksum) {
+            continue;
+        }
+
+        std::int64_t values[4]; // s, tScan, tSwitch, tEB
+        std::memcpy(values, payload, sizeof(values));
+        double pEB;
+        std::memcpy(&pEB, payload + sizeof(values), sizeof(pEB));
+        const unsigned char *pSRs = payload + sizeof(values) + sizeof(pEB);
+        const unsigned char *channels = pSRs + chs.size() * sizeof(double);
+
+        // compare the parameters, since different parameters may have the same hash
+        bool equal = values[0] == syncParams.getS() and values[1] == syncParams.getTScan().count() and
+                     values[2] == syncParams.getTSwitch().count() and values[3] == syncParams.getTeb().count() and
+                     pEB == syncParams.getPeb();
+        for (size_t i = 0; equal and i < chs.size(); i++) {
+            std::int32_t channel;
+            double p;
+            std::memcpy(&channel, channels + i * sizeof(channel), sizeof(channel));
+            std::memcpy(&p, pSRs + i * sizeof(p), sizeof(p));
+            equal = channel == chs[i] and p == pSR.at(chs[i]);
+        }
+        if (!equal) {
+            continue;
+        }
+
+        if (results != nullptr) {
+            const unsigned char *cdf = channels + chs.size() * sizeof(std::int32_t);
+            results->avgSyncTime_ = std::chrono::duration<double>(header.avgSyncTime);
+            results->avgSyncTimeError_ = std::chrono::duration<double>(header.avgSyncTimeError);
+            results->singlePrecision_ = header.flags & SINGLE_PRECISION_FLAG;
+            std::vector<double> cdfValues(header.cdfSize + 1, 0);
+            for (size_t k = 1; k <= header.cdfSize; k++) {
+                std::uint32_t value;
+                std::memcpy(&value, cdf + (k - 1) * sizeof(value), sizeof(value));
+                cdfValues[k] = value / FIXED_POINT_ONE;
+            }
+            results->cdf_ = CompactCDF(std::move(cdfValues), QUANTIZATION_ERROR,
+                                       Model::Results::tailPeriod(syncParams));
+            results->cdfError_ = header.cdfError + QUANTIZATION_ERROR + results->cdf_.error();
+            results->Tsf_ = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
+            results->Teb_ = syncParams.getTeb();
+            results->calculateMoments();
+        }
+        return true;
+    }
+    return false;
+}
+
+void M6SS::ModelStore::append(const std::vector<const SyncParameters *> &syncParamsSet,
+                              const std::vector<const Model::Results *> &resultsSet) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    FileLock fileLock(fd_);
+
+    remapAndIndex(); // index the records appended by other processes
+    if (indexedEnd_ < mapSize_) { // an incomplete record left by a crash, since no other process is appending
+        if (ftruncate(fd_, indexedEnd_) != 0) {
+            throw std::runtime_error(std::string("Fail to truncate the store: ") + std::strerror(errno));
+        }
+        remapAndIndex();
+    }
+
+    auto hash = [](const SyncParameters *syncParams) { return syncParams->hash(); };
+    auto equal = [](const SyncParameters *a, const SyncParameters *b) { return *a == *b; };
+    std::unordered_set<const SyncParameters *, decltype(hash), decltype(equal)> appended(0, hash, equal);
+
+    std::vector<unsigned char> buffer;
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < syncParamsSet.size(); i++) {
+        if (lookup(*syncParamsSet[i], nullptr) or !appended.insert(syncParamsSet[i]).second) {
+            continue;
+        }
+        offsets.push_back(indexedEnd_ + buffer.size());
+        std::vector<unsigned char> record = encode(*syncParamsSet[i], *resultsSet[i]);
+        buffer.insert(buffer.end(), record.begin(), record.end());
+    }
+
+    if (buffer.empty()) {
+        return;
+    }
+
+    // The records are written as incomplete and then they are marked as complete, so that the other processes never
+    // index a partially written record.
+    writeAll(fd_, buffer.data(), buffer.size(), indexedEnd_);
+    for (size_t offset: offsets) {
+        writeAll(fd_, &COMMITTED, sizeof(COMMITTED), offset + offsetof(RecordHeader, state));
+    }
+
+    remapAndIndex();
+}
+
+std::vector<unsigned char> M6SS::ModelStore::encode(const SyncParameters &syncParams,
+                                                    const Model::Results &results) const {
+    const std::vector<int> &chs = syncParams.getCHS();
+
+    // the last cdf values that are rounded to one are not stored, since cdf() returns one after the stored values
+    size_t cdfSize = results.cdf_.size() - 1;
+    while (cdfSize > 0 and std::lround(results.cdf_[cdfSize] * FIXED_POINT_ONE) >= FIXED_POINT_ONE) {
+        cdfSize--;
+    }
+
+    std::vector<unsigned char> record(recordSize(chs.size(), cdfSize), 0);
+    unsigned char *payload = record.data() + sizeof(RecordHeader);
+    unsigned char *p = payload;
+    auto put = [&p](const auto &value) {
+        std::memcpy(p, &value, sizeof(value));
+        p += sizeof(value);
+    };
+
+    put(std::int64_t(syncParams.getS()));
+    put(std::int64_t(syncParams.getTScan().count()));
+    put(std::int64_t(syncParams.getTSwitch().count()));
+    put(std::int64_t(syncParams.getTeb().count()));
+    put(syncParams.getPeb());
+    for (int channel: chs) {
+        put(syncParams.getPsr().at(channel));
+    }
+    for (int channel: chs) {
+        put(std::int32_t(channel));
+    }
+    for (size_t k = 1; k <= cdfSize; k++) {
+        put(std::uint32_t(std::lround(std::min(1.0, std::max(0.0, results.cdf_[k])) * FIXED_POINT_ONE)));
+    }
+
+    RecordHeader header{};
+    header.state = 0; // it is marked as complete after it has been written
+    header.size = record.size();
+    header.hash = syncParams.hash();
+    header.tolerance = options_.tolerance;
+    header.avgSyncTime = results.avgSyncTime_.count();
+    header.avgSyncTimeError = results.avgSyncTimeError_.count();
+    header.cdfError = results.cdfError_;
+    header.numChannels = chs.size();
+    header.cdfSize = cdfSize;
+    header.flags = results.singlePrecision_ ? SINGLE_PRECISION_FLAG : 0;
+    header.checksum = checksum(header, payload);
+    std::memcpy(record.data(), &header, sizeof(header));
+
+    return record;
+}
+
+size_t M6SS::ModelStore::recordSize(size_t numChannels, size_t cdfSize) {
+    size_t payloadSize = 4 * sizeof(std::int64_t) + sizeof(double) + numChannels * sizeof(double) +
+                         numChannels * sizeof(std::int32_t) + cdfSize * sizeof(std::uint32_t);
+    return sizeof(RecordHeader) + (payloadSize + 7) / 8 * 8;
+}
+
+std::uint64_t M6SS::ModelStore::checksum(const RecordHeader &header, const unsigned char *payload) {
+    // the state is written after the record (see append) and the checksum is not known when it is calculated
+    RecordHeader covered = header;
+    covered.state = 0;
+    covered.checksum = 0;
+    std::uint64_t h = hashWords(reinterpret_cast<const unsigned char *>(&covered), sizeof(covered));
+    return hashWords(payload, header.size - sizeof(RecordHeader), h);
+}
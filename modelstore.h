@@ -0,0 +1,147 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_MODELSTORE_H
+#define M6SS_MODELSTORE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <shared_mutex>
+#include "syncparameters.h"
+#include "model.h"
+
+namespace M6SS {
+
+    /**
+     * This class represents a persistent store of the results of the model, i.e., a file to which the results are
+     * appended, keyed by the canonical hash of the synchronization parameters (see SyncParameters::hash). Each record
+     * holds the parameters (so that hash collisions are detected), the average synchronization time, the error bounds
+     * and the cdf in 32-bit fixed point. The file is memory-mapped and an index of the records is built when the store
+     * is opened, by reading only the header of each record, so the opening is fast even for large stores.
+     *
+     * A store can be shared by several processes (and threads): the appends are serialized through an advisory lock
+     * on the file (flock), and the records that other processes append are found when a lookup misses. A record
+     * becomes visible only after it has been completely written, so a crash during an append leaves at most an
+     * incomplete record at the end of the file, which is discarded by the next append.
+     */
+    class ModelStore {
+    public:
+        /**
+         * Opens (or creates) a store.
+         * @param path the path of the file of the store.
+         * @param options the options of the calculations that are made on misses (see get). A record is used for a
+         * lookup only if it was calculated with a tolerance not greater than options.tolerance, and in double precision
+         * unless options.precision is Mixed.
+         * @throw std::runtime_error if the file cannot be opened or is not a store.
+         */
+        explicit ModelStore(const std::string &path, const Model::Options &options = Model::Options());
+
+        ModelStore(const ModelStore &) = delete;
+
+        ModelStore &operator=(const ModelStore &) = delete;
+
+        ~ModelStore();
+
+        /**
+         * Finds the results of the model for the given parameters.
+         * @param syncParams the synchronization parameters.
+         * @param results on return, the results of the model, if they were found. The cdf is restored from its fixed
+         * point representation, so cdfError() includes the quantization error.
+         * @return true if the results were found, false otherwise.
+         */
+        bool find(const SyncParameters &syncParams, Model::Results &results);
+
+        /**
+         * Returns the results of the model for the given parameters. If they are not in the store, the calculation is
+         * made and the results are appended to the store.
+         * @param syncParams the synchronization parameters.
+         * @param results on return, the results of the model.
+         * @return a reference to the Results object
+         * @throw std::runtime_error if the results cannot be written to the file.
+         */
+        Model::Results &get(const SyncParameters &syncParams, Model::Results &results);
+
+        /**
+         * The same as the function above, for a set of synchronization parameters. The parameter sets that are not in
+         * the store are calculated in parallel (see Model::calculateBatch) and are appended to the store at once.
+         * @param syncParamsSet the parameter sets.
+         * @param results a vector that, on return, contains the results for each parameter set, in the same order.
+         * @return a reference to the results vector
+         * @throw std::runtime_error if the results cannot be written to the file.
+         */
+        std::vector<Model::Results> &getBatch(const std::vector<SyncParameters> &syncParamsSet,
+                                              std::vector<Model::Results> &results);
+
+        /**
+         * Appends the results of the model for the given parameters to the store, unless they are already there.
+         * @param syncParams the synchronization parameters.
+         * @param results the results of the model for syncParams, calculated with the options of the store.
+         * @throw std::runtime_error if the results cannot be written to the file.
+         */
+        void put(const SyncParameters &syncParams, const Model::Results &results);
+
+        /**
+         * Returns the number of records in the store (as known to this instance).
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Returns the path of the file of the store.
+         */
+        [[nodiscard]] const std::string &getPath() const;
+
+    private:
+        struct FileHeader;
+        struct RecordHeader;
+
+        /* Maps the file again if it has grown (e.g., due to appends of other processes) and indexes the new records.
+         * Returns true if new records were found. */
+        bool refresh();
+
+        /* Remaps the file and indexes the complete records after indexedEnd_. It requires the exclusive lock. */
+        void remapAndIndex();
+
+        /* Looks up a record that can be used for syncParams. It requires a lock. */
+        bool lookup(const SyncParameters &syncParams, Model::Results *results) const;
+
+        /* Appends records under the lock of the file, skipping those that are already in the store. */
+        void append(const std::vector<const SyncParameters *> &syncParamsSet,
+                    const std::vector<const Model::Results *> &resultsSet);
+
+        std::vector<unsigned char> encode(const SyncParameters &syncParams, const Model::Results &results) const;
+
+        /* Returns the size of a record (including the header) with the given number of channels and cdf values. */
+        static size_t recordSize(size_t numChannels, size_t cdfSize);
+
+        /* Returns the checksum of a record, which covers the payload and the fields of the header except for the state
+         * and the checksum itself. */
+        static std::uint64_t checksum(const RecordHeader &header, const unsigned char *payload);
+
+        std::string path_;
+        Model::Options options_;
+        int fd_ = -1;
+        const unsigned char *map_ = nullptr;
+        size_t mapSize_ = 0;
+        size_t indexedEnd_ = 0; // the offset after the last indexed record
+        std::unordered_multimap<std::uint64_t, size_t> index_; // hash -> offset of the record
+        mutable std::shared_mutex mutex_;
+    };
+
+}
+
+#endif //M6SS_MODELSTORE_H
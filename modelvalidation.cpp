@@ -18,9 +18,14 @@
 #include <cmath>
 #include <vector>
 #include <thread>
-#include <future>
 #include <algorithm>
 #include <sstream>
+#include <atomic>
+#include <optional>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
 #include "syncparameters.h"
 #include "simulator.h"
 #include "model.h"
@@ -31,228 +36,705 @@ std::random_device, std::vector, std::thread, std::map;
 using namespace std::chrono_literals;
 
 
-int M6SS::ModelValidator::makeValidation(int numThreads) {
+M6SS::ModelValidator::CaseResult::CaseResult(long runId, int flow, long caseIndex, uint64_t seed,
+                                             SyncParameters syncParameters)
+        : runId(runId), flow(flow), caseIndex(caseIndex), seed(seed), syncParameters(std::move(syncParameters)) {}
+
+bool M6SS::ModelValidator::CaseResult::passed() const {
+    return relativeErrorInAVG <= MAX_ALLOWED_ERROR and maxAbsoluteErrorInCDF <= MAX_ALLOWED_ERROR;
+}
+
+int M6SS::ModelValidator::makeValidation(int numThreads, PersistenceMode persistenceMode,
+                                        std::optional<CDFCodec::Encoding> cdfEncoding, CaseDesign caseDesign,
+                                        const std::set<int> &flows) {
 
     if (numThreads < 1) {
         throw std::invalid_argument("numThreads must be greater than zero.");
     }
 
-    std::mutex _mutex;
-    prepareDBSession();
+    if (flows.empty() or *flows.begin() < 1 or *flows.rbegin() > NUM_FLOWS) {
+        throw std::invalid_argument("flows must be a non-empty set of flows in the range [1, NUM_FLOWS].");
+    }
+
+    prepareDBSession(persistenceMode);
+
+    long runId;
+    uint64_t seed;
+    beginRun(runId, seed, caseDesign);
+
+    // the progress of the run, which is loaded before the writer thread starts to use the database
+    std::set<long> completedCases[NUM_FLOWS];
+    bool failed[NUM_FLOWS], optimalScanPeriodFlags[NUM_FLOWS];
+    for (int flow = 1; flow <= NUM_FLOWS; flow++) {
+        loadProgress(runId, flow, completedCases[flow - 1], failed[flow - 1], optimalScanPeriodFlags[flow - 1]);
+    }
+
+    long numRemainingCases = 0;
+    for (int flow: flows) {
+        numRemainingCases += NUM_RANDOM_CASES - static_cast<long>(completedCases[flow - 1].size());
+    }
+    ValidationMetrics metrics(numRemainingCases);
+
+    MPSCQueue<CaseResult> records;
+    std::atomic<bool> stopping = false;
+
+    // The selected flows of the model (1 for n in (0,1), 2 for n in N* and 3 for n real greater than 1 and not
+    // integer) are examined together, so that the cases of a flow fill the threads that would otherwise wait for the
+    // last cases of another flow. Since the validation fails as soon as any of its flows fails, a single token stops
+    // the calculations and the simulations of all the flows once a case has failed, or the statistics cannot be saved.
+    std::atomic<bool> validationFailed = false;
+    std::atomic<bool> optimalScanPeriodFlag[NUM_FLOWS];
+    for (int flow = 1; flow <= NUM_FLOWS; flow++) {
+        if (failed[flow - 1]) {
+            validationFailed = true;
+        }
+        optimalScanPeriodFlag[flow - 1] = optimalScanPeriodFlags[flow - 1];
+    }
+    CancellationToken cancellation;
+    std::exception_ptr writerError;
+
+    // The writer and the reporter are stopped and joined when the validation ends, also through an exception (e.g.,
+    // of runCases), since the destruction of a joinable thread terminates the program. In the latter case, the
+    // database session is also closed, so that the records that have been saved are committed.
+    struct Threads {
+        Threads(std::atomic<bool> &stopping, const std::exception_ptr &writerError)
+                : stopping(stopping), writerError(writerError) {}
+
+        std::atomic<bool> &stopping;
+        const std::exception_ptr &writerError;
+        thread writer, reporter;
+
+        void join() {
+            stopping = true;
+            if (writer.joinable()) {
+                writer.join();
+            }
+            if (reporter.joinable()) {
+                reporter.join();
+            }
+        }
 
-    auto comparisonWithSimulator = [&](auto tScanDistribution) {
-        bool validationFailed = false;
-        bool optimalScanPeriodFlag = true;
-
-        auto worker = [&](int numCases) -> void {
-            random_device randomDevice;
-            mt19937 randomGenerator1(randomDevice()), randomGenerator2(randomDevice()),
-                    randomGenerator3(randomDevice()), randomGenerator4(randomDevice()),
-                    randomGenerator5(randomDevice()), randomGenerator6(randomDevice()),
-                    randomGenerator7(randomDevice()), randomGenerator8(randomDevice());
-
-
-            uniform_int_distribution<int> numChannelsDistribution(1, 16);
-            uniform_int_distribution<int> channelsDistribution(11, 26);
-            uniform_int_distribution<int> slotsDistribution(1, 10000);
-            uniform_real_distribution<double> pEBDistribution(0.1,
-                                                              std::nextafter(1, std::numeric_limits<double>::max()));
-            uniform_real_distribution<double> avgPsrDistribution(0.1,
-                                                                 std::nextafter(1, std::numeric_limits<double>::max()));
-            uniform_int_distribution<int> tEBDistribution(1504, 4256);
-
-            int c, s;
-            double pEB;
-            nanoseconds tEB;
-            int i = 0;
-
-            while (i < numCases) {
-                c = numChannelsDistribution(randomGenerator1); // a random number of channels
-
-                // select a random number of slots that is relatively prime to the number of channels that are in used
-                do {
-                    s = slotsDistribution(randomGenerator2);
-                } while (std::gcd(s, c) != 1);
-
-                std::vector<int> chs;
-                chs.reserve(c);
-                while (chs.size() < c) {
-                    int newChannel;
-                    while (std::find(chs.begin(), chs.end(), (newChannel = channelsDistribution(randomGenerator8))) !=
-                           chs.end());
-                    chs.push_back(newChannel);
+        ~Threads() {
+            if (writer.joinable() or reporter.joinable()) {
+                join();
+                if (!writerError) { // otherwise the session has already been closed
+                    try {
+                        closeDBSession();
+                    } catch (const std::runtime_error &) {}
                 }
+            }
+        }
+    } threads(stopping, writerError);
+
+    // a failure of the writer stops the validation, since the statistics of the following cases could not be saved;
+    // the error is rethrown once the tasks in progress have stopped
+    threads.writer = thread([&records, &stopping, &writerError, &metrics, &validationFailed, &cancellation]() {
+        try {
+            writeRecords(records, stopping, &metrics);
+        } catch (...) {
+            writerError = std::current_exception();
+            validationFailed = true;
+            cancellation.cancel();
+        }
+    });
+
+    // the metrics are rewritten every METRICS_INTERVAL; they are informative, so a failure to write them is ignored
+    threads.reporter = thread([&stopping, &metrics]() {
+        auto lastReport = std::chrono::steady_clock::now();
+        while (not stopping) {
+            std::this_thread::sleep_for(100ms);
+            if (std::chrono::steady_clock::now() - lastReport >= METRICS_INTERVAL) {
+                lastReport = std::chrono::steady_clock::now();
+                try {
+                    metrics.writeFile(METRICS_FILE);
+                } catch (const std::runtime_error &) {}
+            }
+        }
+    });
 
-                // select randomly the probabilities pEB and pSR
-                pEB = pEBDistribution(randomGenerator3);
+    std::atomic<long> numFinishedCases[NUM_FLOWS] = {};
 
-                map<int, double> pSR;
-                double targetAveragePsr = avgPsrDistribution(randomGenerator4);
+    auto onCaseFinished = [&](const CaseResult &result) {
+        numFinishedCases[result.flow - 1]++;
 
-                // Desiring to uniformly distribute the average Psr, instead of creating the Psr values of channels by
-                // randomly selecting the values in the interval (0, 1], we select the Psr values in a random way that
-                // achieves a desired average Psr.
-                double targetSum = targetAveragePsr * c;
-                double sum = 0;
-                vector<double> temp;
-                temp.reserve(c);
+        // save statistics (through the writer thread)
+        metrics.caseCompleted(result.flow);
+        metrics.recordQueued();
+        records.push(result);
 
-                for (int j = 0; j < c; j++) {
-                    double minP = targetSum - sum - c + (j + 1), maxP = targetSum - sum - (c - (j + 1)) * 0.1;
+        if (not result.passed()) {
+            validationFailed = true;
+            cancellation.cancel(); // stop the tasks of the other cases
+            return;
+        }
 
-                    if (minP < 0.1) {
-                        minP = 0.1;
-                    }
-                    if (maxP > 1) {
-                        maxP = 1;
-                    }
+        if (!result.optimalScanPeriodValid) {
+            optimalScanPeriodFlag[result.flow - 1] = false;
+        }
+    };
 
-                    uniform_real_distribution<double> pSRDistribution(minP, std::nextafter(maxP,
-                                                                                           std::numeric_limits<double>::max()));
+    // The cases that have not been completed in a previous execution of the run are taken from the selected flows
+    // that have remaining cases in turn, until all their cases have been examined or the validation has failed (also
+    // when the writer has failed). The parameters of each case are generated from its own seed, so that they are the
+    // same in every execution.
+    const vector<int> selectedFlows(flows.begin(), flows.end());
+    long caseIndex[NUM_FLOWS] = {};
+    size_t turn = 0;
+    auto nextCase = [&]() -> std::optional<CaseResult> {
+        for (size_t attempt = 0; attempt < selectedFlows.size() and not validationFailed; attempt++) {
+            int flow = selectedFlows[turn % selectedFlows.size()];
+            turn++;
+            long &index = caseIndex[flow - 1];
+            while (index < NUM_RANDOM_CASES and completedCases[flow - 1].count(index) > 0) {
+                index++;
+            }
+            if (index < NUM_RANDOM_CASES) {
+                index++;
+                return CaseResult(runId, flow, index - 1, caseSeed(seed, flow, index - 1),
+                                  designCase(caseDesign, flow, seed, index - 1));
+            }
+        }
+        return std::nullopt;
+    };
 
-                    temp.push_back(j == c - 1 ? targetSum - sum : pSRDistribution(randomGenerator7));
-                    sum += temp.back();
-                }
+    // the calling thread waits while the pool executes the tasks
+    {
+        ThreadPool pool(numThreads);
+        runCases(nextCase, pool, cancellation, onCaseFinished, cdfEncoding, &metrics);
+    }
 
-                std::shuffle(temp.begin(), temp.end(), randomGenerator7);
-                for (int j = 0; j < c; j++) {
-                    pSR[chs[j]] = temp[j];
-                }
+    int finalRes = validationFailed ? -1 : 1;
+    for (int flow: flows) {
+        if (finalRes == 1 and !optimalScanPeriodFlag[flow - 1]) {
+            finalRes = 0;
+        }
+    }
 
-                // select randomly a value for the ratio of tScan to slotframe
-                auto n = tScanDistribution(randomGenerator5);
+    // the run is finished once it has failed or all the cases of all the flows have been examined, otherwise it is
+    // resumed by the next call (e.g., for the other flows)
+    bool runFinished = true;
+    for (int flow = 1; flow <= NUM_FLOWS; flow++) {
+        if (static_cast<long>(completedCases[flow - 1].size()) + numFinishedCases[flow - 1] < NUM_RANDOM_CASES) {
+            runFinished = false;
+        }
+    }
+    runFinished = runFinished or validationFailed;
+
+    threads.join();
+    try {
+        metrics.writeFile(METRICS_FILE);
+    } catch (const std::runtime_error &) {}
+    if (writerError) { // the database session has already been closed
+        std::rethrow_exception(writerError);
+    }
 
-                // the rounding has effect only when n is not integer
-                nanoseconds tScan = std::chrono::round<nanoseconds>(
-                        n * s * SyncParameters::DEFAULT_SLOT_DURATION
-                );
+    if (runFinished) {
+        finishRun(runId, finalRes);
+    }
+    closeDBSession();
+    return finalRes;
 
-                tEB = nanoseconds(tEBDistribution(randomGenerator6));
+}
 
-                SyncParameters syncParameters(chs, s, pEB, pSR, tScan, 0ns, tEB);
+M6SS::ModelValidator::CaseResult M6SS::ModelValidator::replayCase(long runId, int flow, long caseIndex,
+                                                                  int numThreads) {
+    if (numThreads < 1) {
+        throw std::invalid_argument("numThreads must be greater than zero.");
+    }
 
-                Simulator::Results sim_results;
-                Simulator::run(syncParameters, NUM_SIM_SAMPLES_PER_CASE, sim_results);
+    if (flow < 1 or flow > NUM_FLOWS) {
+        throw std::invalid_argument("flow must be in the range [1, NUM_FLOWS].");
+    }
 
-                Model::Results model_results;
-                Model::calculate(syncParameters, model_results);
+    if (caseIndex < 0 or caseIndex >= NUM_RANDOM_CASES) {
+        throw std::invalid_argument("caseIndex must be in the range [0, NUM_RANDOM_CASES).");
+    }
 
-                double relativeErrorInAVG =
-                        std::chrono::abs(model_results.avgSyncTime() - sim_results.avgSyncTime()) /
-                        sim_results.avgSyncTime();
+    prepareDBSession();
+    sqlite3_stmt *select = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT seed, design FROM runs WHERE runId = ?", -1, &select, nullptr) != SQLITE_OK or
+        sqlite3_bind_int64(select, 1, runId) != SQLITE_OK) {
+        sqlite3_finalize(select);
+        throwDBError();
+    }
+    int rc = sqlite3_step(select);
+    uint64_t seed = rc == SQLITE_ROW ? static_cast<uint64_t>(sqlite3_column_int64(select, 0)) : 0;
+    CaseDesign caseDesign = rc == SQLITE_ROW ? static_cast<CaseDesign>(sqlite3_column_int(select, 1)) :
+                            CaseDesign::Random;
+    sqlite3_finalize(select);
+    closeDBSession();
 
-                double maxAbsoluteErrorInCDF = -1;
+    if (rc != SQLITE_ROW) {
+        throw std::invalid_argument("There is no run with the given id.");
+    }
 
-                for (int k = 1; model_results.cdf(k) < 1 or sim_results.cdf(k) < 1; k++) {
-                    double absoluteErrorInCDF = std::abs(model_results.cdf(k) - sim_results.cdf(k));
+    bool started = false;
+    auto nextCase = [&]() -> std::optional<CaseResult> {
+        if (started) {
+            return std::nullopt;
+        }
+        started = true;
+        return CaseResult(runId, flow, caseIndex, caseSeed(seed, flow, caseIndex),
+                          designCase(caseDesign, flow, seed, caseIndex));
+    };
+    std::optional<CaseResult> result;
+    ThreadPool pool(numThreads);
+    CancellationToken cancellation; // cancelled only if a task fails, in which case runCases throws
+    runCases(nextCase, pool, cancellation, [&result](const CaseResult &finished) { result = finished; },
+             CDFCodec::Encoding::Float);
+    return *result;
+}
 
-                    if (absoluteErrorInCDF > maxAbsoluteErrorInCDF) {
-                        maxAbsoluteErrorInCDF = absoluteErrorInCDF;
-                    }
-                }
+void M6SS::ModelValidator::runCases(const std::function<std::optional<CaseResult>()> &nextCase, ThreadPool &pool,
+                                    CancellationToken &cancellation,
+                                    const std::function<void(const CaseResult &)> &onCaseFinished,
+                                    std::optional<CDFCodec::Encoding> cdfEncoding, ValidationMetrics *metrics) {
+    // Each case is split into tasks, i.e., the two calculations of the model and the chunks of the samples of the
+    // simulator, which are submitted to the pool (the calculations of the model, which may be long in Case 3, first).
+    //
+    // The chunks are simulated in stages. The first stage simulates a single chunk, and each following stage doubles
+    // the samples of the case while it is still undecided (see decide), up to NUM_SIM_SAMPLES_PER_CASE. The last task
+    // of a stage evaluates the case and then either submits the chunks of the next stage, or finishes the case and
+    // starts the next one in its slot, so that no thread waits for the stages of the other cases.
+    struct Case {
+        std::optional<CaseResult> result;
+        Model::Results modelResults, modelResultsWithOptimalScanPeriod;
+        Simulator::Results simResults; // the merged results of the chunks simulated so far
+        vector<Simulator::Results> chunks; // the results of the chunks of the current stage
+        long numChunks = 0; // the number of the chunks simulated so far
+        long numNewChunks = 0; // the number of the chunks of the current stage
+        std::atomic<long> pendingTasks = 0; // the tasks of the current stage that have not finished yet
+    };
+    vector<Case> slots(NUM_CASES_IN_FLIGHT);
+
+    Model::Options modelOptions;
+    modelOptions.cancellation = &cancellation;
+
+    std::mutex mutex; // guards the following variables and the calls of nextCase
+    std::condition_variable idle;
+    long numTasks = 0; // the tasks that have been submitted and have not finished yet
+    bool exhausted = false;
+    std::exception_ptr error;
+
+    std::function<void(size_t, long)> submit; // submits a part of the case of a slot (see task)
+
+    auto startCase = [&](size_t slot) {
+        std::optional<CaseResult> result;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (not exhausted and not cancellation.isCancelled()) {
+                result = nextCase();
+                exhausted = not result;
+            }
+        }
+        if (not result) {
+            return;
+        }
 
-                nanoseconds optimalTscan = c * s * SyncParameters::DEFAULT_SLOT_DURATION;
-                // compare with the optimal value of scan period (i.e., c slotframes)
-                SyncParameters syncParametersWithOptimalScanPeriod(chs, s, pEB, pSR, optimalTscan, 0ns, tEB);
-                Model::Results modelResultsWithOptimalScanPeriod;
-                Model::calculate(syncParametersWithOptimalScanPeriod, modelResultsWithOptimalScanPeriod);
-
-                auto isOptimalScanPeriodValid = [&model_results, &modelResultsWithOptimalScanPeriod]() {
-                    return model_results.avgSyncTime() >= modelResultsWithOptimalScanPeriod.avgSyncTime() or
-                           // due to the possible precision error we also check if the two values are equal with the precision
-                           // of six decimal places (i.e., with microsecond accuracy)
-                           ((long long) model_results.avgSyncTime().count() * 1000000) ==
-                           ((long long) modelResultsWithOptimalScanPeriod.avgSyncTime().count() * 1000000);
-                };
-
-                // save statistics
-                if (numThreads > 1) {
-                    std::lock_guard<std::mutex> guard(_mutex);
-                    save(syncParameters, relativeErrorInAVG, maxAbsoluteErrorInCDF);
-
-                    if (validationFailed) { // check if another thread set validationFailed = true
-                        return;
-                    }
-
-                    if (relativeErrorInAVG > MAX_ALLOWED_ERROR or maxAbsoluteErrorInCDF > MAX_ALLOWED_ERROR) {
-                        validationFailed = true;
-                        return;
-                    }
-
-                    if (!isOptimalScanPeriodValid()) {
-                        optimalScanPeriodFlag = false;
-                    }
-
-                } else {
-                    save(syncParameters, relativeErrorInAVG, maxAbsoluteErrorInCDF);
-
-                    if (relativeErrorInAVG > MAX_ALLOWED_ERROR or maxAbsoluteErrorInCDF > MAX_ALLOWED_ERROR) {
-                        validationFailed = true;
-                        return;
-                    }
-
-                    if (!isOptimalScanPeriodValid()) {
-                        optimalScanPeriodFlag = false;
-                    }
-                }
+        Case &state = slots[slot];
+        state.result = std::move(result);
+        state.simResults = Simulator::Results();
+        state.numChunks = 0;
+        state.numNewChunks = 1;
+        state.chunks.assign(state.numNewChunks, Simulator::Results());
+        state.pendingTasks = state.numNewChunks + 2;
+        submit(slot, -2);
+        submit(slot, -1);
+        submit(slot, 0);
+    };
+
+    auto evaluate = [&](size_t slot) {
+        Case &state = slots[slot];
+        CaseResult &result = *state.result;
+        for (const Simulator::Results &chunk: state.chunks) {
+            state.simResults.merge(chunk);
+        }
+        state.numChunks += state.numNewChunks;
+        state.chunks.clear();
+
+        Model::Results &model_results = state.modelResults;
+        Model::Results &modelResultsWithOptimalScanPeriod = state.modelResultsWithOptimalScanPeriod;
+        Simulator::Results &sim_results = state.simResults;
+
+        double relativeErrorInAVG =
+                std::chrono::abs(model_results.avgSyncTime() - sim_results.avgSyncTime()) /
+                sim_results.avgSyncTime();
 
-                i++;
+        double maxAbsoluteErrorInCDF = -1;
+        vector<double> modelCDF, simulatorCDF; // the cdfs to encode, if any
+
+        for (int k = 1; model_results.cdf(k) < 1 or sim_results.cdf(k) < 1; k++) {
+            double absoluteErrorInCDF = std::abs(model_results.cdf(k) - sim_results.cdf(k));
+            if (cdfEncoding) {
+                modelCDF.push_back(model_results.cdf(k));
+                simulatorCDF.push_back(sim_results.cdf(k));
+            }
+
+            if (absoluteErrorInCDF > maxAbsoluteErrorInCDF) {
+                maxAbsoluteErrorInCDF = absoluteErrorInCDF;
+            }
+        }
+
+        if (state.numChunks < NUM_SIM_CHUNKS_PER_CASE and
+            decide(model_results.avgSyncTime().count(), sim_results.avgSyncTime().count(),
+                   sim_results.syncTimeStdDev().count(), maxAbsoluteErrorInCDF, sim_results.numRuns()) ==
+            Decision::Undecided) {
+            // more samples are needed
+            state.numNewChunks = std::min(state.numChunks, NUM_SIM_CHUNKS_PER_CASE - state.numChunks);
+            state.chunks.assign(state.numNewChunks, Simulator::Results());
+            state.pendingTasks = state.numNewChunks;
+            for (long chunk = state.numChunks; chunk < state.numChunks + state.numNewChunks; chunk++) {
+                submit(slot, chunk);
             }
+            return;
+        }
+
+        auto isOptimalScanPeriodValid = [&model_results, &modelResultsWithOptimalScanPeriod]() {
+            return model_results.avgSyncTime() >= modelResultsWithOptimalScanPeriod.avgSyncTime() or
+                   // due to the possible precision error we also check if the two values are equal with the precision
+                   // of six decimal places (i.e., with microsecond accuracy)
+                   ((long long) model_results.avgSyncTime().count() * 1000000) ==
+                   ((long long) modelResultsWithOptimalScanPeriod.avgSyncTime().count() * 1000000);
         };
 
-        if (numThreads == 1) {
-            worker(NUM_RANDOM_CASES);
+        result.relativeErrorInAVG = relativeErrorInAVG;
+        result.maxAbsoluteErrorInCDF = maxAbsoluteErrorInCDF;
+        result.optimalScanPeriodValid = isOptimalScanPeriodValid();
+        result.numSamples = sim_results.numRuns();
+        if (cdfEncoding) {
+            result.modelCDF = CDFCodec::encode(modelCDF, *cdfEncoding);
+            result.simulatorCDF = CDFCodec::encode(simulatorCDF, *cdfEncoding);
+        }
+        onCaseFinished(result);
+        startCase(slot);
+    };
+
+    // a part of a case is -2 and -1 for the calculations of the model, or the index of a chunk
+    auto task = [&](size_t slot, long part) {
+        Case &state = slots[slot];
+        const CaseResult &result = *state.result;
+        const SyncParameters &syncParameters = result.syncParameters;
+        const auto start = std::chrono::steady_clock::now();
+        if (part == -2) {
+            Model::calculate(syncParameters, state.modelResults, modelOptions);
+            if (metrics) {
+                // the flows are numbered as the cases of the model
+                metrics->modelEvaluation(result.flow, std::chrono::steady_clock::now() - start);
+            }
+        } else if (part == -1) {
+            // compare with the optimal value of scan period (i.e., c slotframes)
+            nanoseconds optimalTscan = static_cast<int>(syncParameters.getCHS().size()) * syncParameters.getS() *
+                                       SyncParameters::DEFAULT_SLOT_DURATION;
+            SyncParameters syncParametersWithOptimalScanPeriod(syncParameters.getCHS(), syncParameters.getS(),
+                                                               syncParameters.getPeb(), syncParameters.getPsr(),
+                                                               optimalTscan, 0ns, syncParameters.getTeb());
+            Model::calculate(syncParametersWithOptimalScanPeriod, state.modelResultsWithOptimalScanPeriod,
+                             modelOptions);
+            if (metrics) {
+                // the optimal scan period is an integer multiple of the step, i.e., Case 2 of the model
+                metrics->modelEvaluation(2, std::chrono::steady_clock::now() - start);
+            }
         } else {
-            vector<thread> threads;
-            for (int i = 1; i <= numThreads; i++) {
-                if (NUM_RANDOM_CASES % numThreads >= i) {
-                    threads.push_back(thread(worker, NUM_RANDOM_CASES / numThreads + 1));
-                } else {
-                    threads.push_back(thread(worker, NUM_RANDOM_CASES / numThreads));
-                }
+            const long numRuns = std::min(NUM_SIM_SAMPLES_PER_CHUNK,
+                                          NUM_SIM_SAMPLES_PER_CASE - part * NUM_SIM_SAMPLES_PER_CHUNK);
+            Simulator::run(syncParameters, numRuns, state.chunks[part - state.numChunks], cancellation,
+                           chunkSeed(result.seed, part));
+            if (metrics) {
+                metrics->simulation(numRuns, std::chrono::steady_clock::now() - start);
+            }
+        }
+
+        if (state.pendingTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            evaluate(slot);
+        }
+    };
+
+    // Any failure stops the other tasks through the token, and is rethrown once all the tasks have finished, since
+    // they refer to the state of this function.
+    auto fail = [&]() {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+        cancellation.cancel();
+    };
+
+    submit = [&](size_t slot, long part) {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            numTasks++;
+        }
+        auto run = [&, slot, part]() {
+            try {
+                cancellation.throwIfCancelled();
+                task(slot, part);
+            } catch (const OperationCancelled &) {
+                // the case is abandoned
+            } catch (...) {
+                fail();
             }
 
-            for (auto &t : threads) {
-                t.join();
+            std::lock_guard<std::mutex> guard(mutex);
+            if (--numTasks == 0) {
+                idle.notify_all();
             }
+        };
+        try {
+            pool.submit(run);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(mutex);
+            numTasks--;
+            throw;
         }
+    };
 
-        if (validationFailed) {
-            return -1;
-        } else if (!optimalScanPeriodFlag) {
-            return 0;
+    try {
+        for (size_t slot = 0; slot < slots.size(); slot++) {
+            startCase(slot);
         }
-        return 1;
+    } catch (...) {
+        fail();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&numTasks]() { return numTasks == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
 
+M6SS::ModelValidator::Decision M6SS::ModelValidator::decide(double modelAvg, double simAvg, double simStdDev,
+                                                            double maxAbsoluteErrorInCDF, long numSamples) {
+    // The probability of a wrong decision is split between the two tests and the decisions that are made for a case,
+    // i.e., one after each stage but the last one (see runCases).
+    static const double alpha = []() {
+        int numDecisions = 0;
+        for (long numChunks = 1; numChunks < NUM_SIM_CHUNKS_PER_CASE; numChunks *= 2) {
+            numDecisions++;
+        }
+        return (1 - DECISION_CONFIDENCE) / (2 * std::max(numDecisions, 1));
+    }();
+
+    // the (1 - alpha/2)-quantile of the standard normal distribution, found through bisection on erfc
+    static const double z = []() {
+        double low = 0, high = 40;
+        for (int iteration = 0; iteration < 200; iteration++) {
+            double middle = (low + high) / 2;
+            (std::erfc(middle / std::sqrt(2.0)) > alpha ? low : high) = middle;
+        }
+        return high;
+    }();
+
+    // the confidence interval of the mean synchronization time, from the central limit theorem
+    const double h = z * simStdDev / std::sqrt(static_cast<double>(numSamples));
+    // the half-width of the band of the empirical cdf, from the Dvoretzky-Kiefer-Wolfowitz inequality
+    const double epsilon = std::sqrt(std::log(2 / alpha) / (2.0 * numSamples));
+
+    const double avgDifference = std::abs(modelAvg - simAvg);
+    const bool avgPasses = avgDifference + h <= MAX_ALLOWED_ERROR * (simAvg - h);
+    const bool avgFails = avgDifference - h > MAX_ALLOWED_ERROR * (simAvg + h);
+    const bool cdfPasses = maxAbsoluteErrorInCDF + epsilon <= MAX_ALLOWED_ERROR;
+    const bool cdfFails = maxAbsoluteErrorInCDF - epsilon > MAX_ALLOWED_ERROR;
+
+    if (avgFails or cdfFails) {
+        return Decision::Fail;
+    }
+    if (avgPasses and cdfPasses) {
+        return Decision::Pass;
+    }
+    return Decision::Undecided;
+}
+
+uint64_t M6SS::ModelValidator::caseSeed(uint64_t runSeed, int flow, long caseIndex) {
+    std::seed_seq sequence{static_cast<uint32_t>(runSeed), static_cast<uint32_t>(runSeed >> 32),
+                           static_cast<uint32_t>(flow), static_cast<uint32_t>(caseIndex)};
+    uint32_t seed[2];
+    sequence.generate(seed, seed + 2);
+    return static_cast<uint64_t>(seed[1]) << 32 | seed[0];
+}
+
+uint64_t M6SS::ModelValidator::chunkSeed(uint64_t caseSeed, long chunk) {
+    std::seed_seq sequence{static_cast<uint32_t>(caseSeed), static_cast<uint32_t>(caseSeed >> 32),
+                           static_cast<uint32_t>(chunk)};
+    uint32_t seed[2];
+    sequence.generate(seed, seed + 2);
+    return static_cast<uint64_t>(seed[1]) << 32 | seed[0];
+}
+
+M6SS::SyncParameters M6SS::ModelValidator::randomCase(int flow, uint64_t seed) {
+    switch (flow) {
+        case 1: // for n in (0,1)
+            return randomCase(uniform_real_distribution<>(0.1, 1), seed);
+        case 2: // for n in N*
+            return randomCase(uniform_int_distribution<>(1, 100), seed);
+        case 3: // for n real greater than 1 and not integer
+            return randomCase(custom_real_n_distribution<>(1, 100), seed);
+        default:
+            throw std::invalid_argument("flow must be in the range [1, NUM_FLOWS].");
+    }
+}
+
+M6SS::SyncParameters M6SS::ModelValidator::designCase(CaseDesign caseDesign, int flow, uint64_t runSeed,
+                                                      long caseIndex) {
+    const uint64_t seed = caseSeed(runSeed, flow, caseIndex);
+    if (caseDesign == CaseDesign::Random) {
+        return randomCase(flow, seed);
+    }
+
+    // the cases of each flow are the points of a Sobol sequence with its own scrambling, whose seed is derived as that
+    // of a case with index -1
+    SobolSequence design(SOBOL_DIMENSIONS, caseSeed(runSeed, flow, -1));
+    return sobolCase(flow, design, caseIndex, seed);
+}
+
+template<class Distribution>
+M6SS::SyncParameters M6SS::ModelValidator::randomCase(Distribution tScanDistribution, uint64_t seed) {
+    // a separate generator for each of the random selections, all of them derived from the seed of the case
+    auto generator = [seed](uint32_t selection) {
+        std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), selection};
+        return mt19937(sequence);
     };
+    mt19937 randomGenerator1 = generator(1), randomGenerator2 = generator(2), randomGenerator3 = generator(3),
+            randomGenerator4 = generator(4), randomGenerator5 = generator(5), randomGenerator6 = generator(6);
 
-    int comparisonRes1 = -1, comparisonRes2 = -1, comparisonRes3 = -1;
-    int finalRes;
-    if (
+    uniform_int_distribution<int> numChannelsDistribution(1, 16);
+    uniform_int_distribution<int> slotsDistribution(1, 10000);
+    uniform_real_distribution<double> pEBDistribution(0.1,
+                                                      std::nextafter(1, std::numeric_limits<double>::max()));
+    uniform_real_distribution<double> avgPsrDistribution(0.1,
+                                                         std::nextafter(1, std::numeric_limits<double>::max()));
+    uniform_int_distribution<int> tEBDistribution(1504, 4256);
 
-            (comparisonRes1 = comparisonWithSimulator(uniform_real_distribution<>(0.1, 1))) == -1 // for n in (0,1)
-            or
-            (comparisonRes2 = comparisonWithSimulator(uniform_int_distribution<>(1, 100))) == -1 // for n in N*
-            or
-            // for n real greater than 1 and not integer
-            (comparisonRes3 = comparisonWithSimulator(custom_real_n_distribution<>(1, 100))) == -1
+    int c, s;
+    double pEB;
+    nanoseconds tEB;
 
-            ) {
-        finalRes = -1;
-    } else if (comparisonRes1 == 0 or comparisonRes2 == 0 or comparisonRes3 == 0) {
-        finalRes = 0;
-    } else {
-        finalRes = 1;
+    c = numChannelsDistribution(randomGenerator1); // a random number of channels
+
+    // select a random number of slots that is relatively prime to the number of channels that are in used
+    do {
+        s = slotsDistribution(randomGenerator2);
+    } while (std::gcd(s, c) != 1);
+
+    // select randomly the probabilities pEB and the average Psr
+    pEB = pEBDistribution(randomGenerator3);
+    double targetAveragePsr = avgPsrDistribution(randomGenerator4);
+
+    // select randomly a value for the ratio of tScan to slotframe
+    auto n = tScanDistribution(randomGenerator5);
+
+    tEB = nanoseconds(tEBDistribution(randomGenerator6));
+
+    return makeCase(c, s, pEB, targetAveragePsr, n, tEB, seed);
+}
+
+M6SS::SyncParameters M6SS::ModelValidator::sobolCase(int flow, const SobolSequence &design, long caseIndex,
+                                                     uint64_t seed) {
+    // the coordinates of the point of the case, which are mapped to the parameters through the inverse cdfs of the
+    // same distributions as in randomCase
+    vector<double> u = design.point(static_cast<uint32_t>(caseIndex));
+
+    int c = 1 + static_cast<int>(u[0] * 16);
+
+    // the number of slots, among the numbers in [1, 10000] that are relatively prime to the number of channels
+    vector<int> slots;
+    for (int s = 1; s <= 10000; s++) {
+        if (std::gcd(s, c) == 1) {
+            slots.push_back(s);
+        }
+    }
+    int s = slots[static_cast<size_t>(u[1] * slots.size())];
+
+    double pEB = 0.1 + 0.9 * u[2];
+    double targetAveragePsr = 0.1 + 0.9 * u[3];
+
+    double n;
+    switch (flow) {
+        case 1: // for n in (0,1)
+            n = 0.1 + 0.9 * u[4];
+            break;
+        case 2: // for n in N*
+            n = 1 + std::floor(u[4] * 100);
+            break;
+        case 3: // for n real greater than 1 and not integer
+            n = custom_real_n_distribution<>(1, 100)(u[5], u[4], u[6]);
+            break;
+        default:
+            throw std::invalid_argument("flow must be in the range [1, NUM_FLOWS].");
     }
 
-    closeDBSession();
-    return finalRes;
+    nanoseconds tEB(1504 + static_cast<int>(u[7] * (4256 - 1504 + 1)));
 
+    return makeCase(c, s, pEB, targetAveragePsr, n, tEB, seed);
 }
 
-void M6SS::ModelValidator::prepareDBSession() {
+M6SS::SyncParameters M6SS::ModelValidator::makeCase(int c, int s, double pEB, double targetAveragePsr, double n,
+                                                    nanoseconds tEB, uint64_t seed) {
+    // a separate generator for each of the random selections, all of them derived from the seed of the case
+    auto generator = [seed](uint32_t selection) {
+        std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), selection};
+        return mt19937(sequence);
+    };
+    mt19937 randomGenerator7 = generator(7), randomGenerator8 = generator(8);
+
+    uniform_int_distribution<int> channelsDistribution(11, 26);
+
+    std::vector<int> chs;
+    chs.reserve(c);
+    while (chs.size() < c) {
+        int newChannel;
+        while (std::find(chs.begin(), chs.end(), (newChannel = channelsDistribution(randomGenerator8))) !=
+               chs.end());
+        chs.push_back(newChannel);
+    }
+
+    map<int, double> pSR;
+
+    // Desiring to uniformly distribute the average Psr, instead of creating the Psr values of channels by
+    // randomly selecting the values in the interval (0, 1], we select the Psr values in a random way that
+    // achieves a desired average Psr.
+    double targetSum = targetAveragePsr * c;
+    double sum = 0;
+    vector<double> temp;
+    temp.reserve(c);
+
+    for (int j = 0; j < c; j++) {
+        double minP = targetSum - sum - c + (j + 1), maxP = targetSum - sum - (c - (j + 1)) * 0.1;
+
+        if (minP < 0.1) {
+            minP = 0.1;
+        }
+        if (maxP > 1) {
+            maxP = 1;
+        }
+
+        uniform_real_distribution<double> pSRDistribution(minP, std::nextafter(maxP,
+                                                                               std::numeric_limits<double>::max()));
+
+        temp.push_back(j == c - 1 ? targetSum - sum : pSRDistribution(randomGenerator7));
+        sum += temp.back();
+    }
+
+    std::shuffle(temp.begin(), temp.end(), randomGenerator7);
+    for (int j = 0; j < c; j++) {
+        pSR[chs[j]] = temp[j];
+    }
+
+    // the rounding has effect only when n is not integer
+    nanoseconds tScan = std::chrono::round<nanoseconds>(
+            n * s * SyncParameters::DEFAULT_SLOT_DURATION
+    );
+
+    return SyncParameters(chs, s, pEB, pSR, tScan, 0ns, tEB);
+}
+
+void M6SS::ModelValidator::prepareDBSession(PersistenceMode mode) {
     stmt = nullptr;
+    multiRowStmt = nullptr;
+    cdfStmt = nullptr;
     insertCounter = 0;
+    transactionOpen = false;
+    persistence = mode;
 
     if (sqlite3_open("modelvalidation.db", &db)) {
         throw std::runtime_error(sqlite3_errmsg(db));
@@ -270,9 +752,30 @@ void M6SS::ModelValidator::prepareDBSession() {
                                        "maxAbsoluteErrorInCDF REAL"
                                        ")";
 
+    // the runs of the validation (see beginRun)
+    // the cdfs of the cases, if they are stored (see makeValidation)
+    std::string createCDFsTableStatement = "CREATE TABLE IF NOT EXISTS cdfs ("
+                                           "runId INTEGER,"
+                                           "flow INTEGER,"
+                                           "caseIndex INTEGER,"
+                                           "modelCDF BLOB,"
+                                           "simulatorCDF BLOB,"
+                                           "PRIMARY KEY (runId, flow, caseIndex)"
+                                           ")";
+
+    std::string createRunsTableStatement = "CREATE TABLE IF NOT EXISTS runs ("
+                                           "runId INTEGER PRIMARY KEY,"
+                                           "seed INTEGER,"
+                                           "status TEXT,"
+                                           "result INTEGER,"
+                                           "design INTEGER DEFAULT 0"
+                                           ")";
+
     char *err_msg = nullptr;
     if (
             sqlite3_exec(db, createTableStatement.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK or
+            sqlite3_exec(db, createRunsTableStatement.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK or
+            sqlite3_exec(db, createCDFsTableStatement.c_str(), nullptr, nullptr, &err_msg) != SQLITE_OK or
             sqlite3_exec(db, "PRAGMA cache_size=10000", nullptr, nullptr, &err_msg) != SQLITE_OK
             ) {
         std::string error = err_msg;
@@ -281,102 +784,389 @@ void M6SS::ModelValidator::prepareDBSession() {
         throw std::runtime_error(error);
     }
 
+    // the journal of the fast mode, which lets a commit append to the log instead of syncing the database itself
+    if (mode == PersistenceMode::Fast and
+        (sqlite3_exec(db, "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr) != SQLITE_OK or
+         sqlite3_exec(db, "PRAGMA synchronous=NORMAL", nullptr, nullptr, nullptr) != SQLITE_OK)) {
+        throwDBError();
+    }
+
+    // The columns that identify the case of each row (and the design of each run); they are added to the tables of
+    // previous versions, whose rows are left without a run (and whose runs have the Random design, i.e., 0). A case is
+    // saved once per run, even if it is repeated (e.g., by a restarted run).
+    const char *newColumns[][3] = {{"statistics", "runId", "INTEGER"}, {"statistics", "flow", "INTEGER"},
+                                   {"statistics", "caseIndex", "INTEGER"}, {"statistics", "seed", "INTEGER"},
+                                   {"statistics", "optimalScanPeriodValid", "INTEGER"},
+                                   {"statistics", "numSamples", "INTEGER"}, {"runs", "design", "INTEGER DEFAULT 0"}};
+    for (const auto &column: newColumns) {
+        sqlite3_stmt *select = nullptr;
+        std::string query = std::string("SELECT 1 FROM pragma_table_info('") + column[0] + "') WHERE name = '" +
+                            column[1] + "'";
+        if (sqlite3_prepare_v2(db, query.c_str(), -1, &select, nullptr) != SQLITE_OK) {
+            throwDBError();
+        }
+        bool exists = sqlite3_step(select) == SQLITE_ROW;
+        sqlite3_finalize(select);
+
+        std::string alter = std::string("ALTER TABLE ") + column[0] + " ADD COLUMN " + column[1] + " " + column[2];
+        if (not exists and sqlite3_exec(db, alter.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK) {
+            throwDBError();
+        }
+    }
+
+    if (sqlite3_exec(db, "CREATE UNIQUE INDEX IF NOT EXISTS statisticsCase ON statistics(runId, flow, caseIndex)",
+                     nullptr, nullptr, nullptr) != SQLITE_OK) {
+        throwDBError();
+    }
+
+    const std::string insert = "INSERT OR REPLACE INTO statistics (c, chs, s, pEB, averagePsr, Psr, tSCAN, "
+                               "relativeErrorInAVG, maxAbsoluteErrorInCDF, runId, flow, caseIndex, seed, "
+                               "optimalScanPeriodValid, numSamples) VALUES";
+    const std::string row = "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+    std::string multiRowInsert = insert;
+    for (int i = 0; i < ROWS_PER_INSERT; i++) {
+        multiRowInsert += (i == 0 ? "" : ", ") + row;
+    }
 
-    if (sqlite3_prepare_v2(db, "INSERT INTO statistics VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?)", -1, &stmt, nullptr) !=
-        SQLITE_OK) {
+    if (sqlite3_prepare_v2(db, (insert + row).c_str(), -1, &stmt, nullptr) != SQLITE_OK or
+        sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO cdfs (runId, flow, caseIndex, modelCDF, simulatorCDF) "
+                               "VALUES(?, ?, ?, ?, ?)", -1, &cdfStmt, nullptr) != SQLITE_OK or
+        (mode == PersistenceMode::Fast and
+         sqlite3_prepare_v2(db, multiRowInsert.c_str(), -1, &multiRowStmt, nullptr) != SQLITE_OK)) {
         closeDBSession();
         throw std::runtime_error("Fail to prepare statement.");
     }
 }
 
+void M6SS::ModelValidator::beginRun(long &runId, uint64_t &seed, CaseDesign &caseDesign) {
+    // resume the last run that has not finished (e.g., due to a crash), if any
+    sqlite3_stmt *select = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT runId, seed, design FROM runs WHERE status = 'running' "
+                               "ORDER BY runId DESC LIMIT 1", -1, &select, nullptr) != SQLITE_OK) {
+        throwDBError();
+    }
+    bool found = sqlite3_step(select) == SQLITE_ROW;
+    if (found) {
+        runId = sqlite3_column_int64(select, 0);
+        seed = static_cast<uint64_t>(sqlite3_column_int64(select, 1));
+        caseDesign = static_cast<CaseDesign>(sqlite3_column_int(select, 2));
+    }
+    sqlite3_finalize(select);
+    if (found) {
+        return;
+    }
+
+    random_device randomDevice;
+    seed = static_cast<uint64_t>(randomDevice()) << 32 | randomDevice();
+
+    sqlite3_stmt *insert = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT INTO runs (seed, status, design) VALUES(?, 'running', ?)", -1, &insert,
+                           nullptr) != SQLITE_OK or
+        sqlite3_bind_int64(insert, 1, static_cast<sqlite3_int64>(seed)) != SQLITE_OK or
+        sqlite3_bind_int(insert, 2, static_cast<int>(caseDesign)) != SQLITE_OK or
+        sqlite3_step(insert) != SQLITE_DONE) {
+        sqlite3_finalize(insert);
+        throwDBError();
+    }
+    sqlite3_finalize(insert);
+    runId = sqlite3_last_insert_rowid(db);
+}
 
-void M6SS::ModelValidator::save(const SyncParameters &syncParameters,
-                                double relativeErrorInAVG,
-                                double maxAbsoluteErrorInCDF) {
+void M6SS::ModelValidator::loadProgress(long runId, int flow, std::set<long> &completedCases, bool &failed,
+                                        bool &optimalScanPeriodFlag) {
+    completedCases.clear();
+    failed = false;
+    optimalScanPeriodFlag = true;
+
+    sqlite3_stmt *select = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT caseIndex, relativeErrorInAVG, maxAbsoluteErrorInCDF, optimalScanPeriodValid "
+                               "FROM statistics WHERE runId = ? AND flow = ?", -1, &select, nullptr) != SQLITE_OK or
+        sqlite3_bind_int64(select, 1, runId) != SQLITE_OK or
+        sqlite3_bind_int(select, 2, flow) != SQLITE_OK) {
+        sqlite3_finalize(select);
+        throwDBError();
+    }
 
-    std::string stringCHS, stringPsr;
-    std::stringstream ss, ss2;
-    ss << "[";
-    for (auto it = syncParameters.getCHS().begin(); it != syncParameters.getCHS().end(); ++it) {
-        ss << *it;
-        if (it + 1 != syncParameters.getCHS().end()) {
-            ss << ",";
+    int rc;
+    while ((rc = sqlite3_step(select)) == SQLITE_ROW) {
+        completedCases.insert(sqlite3_column_int64(select, 0));
+        if (sqlite3_column_double(select, 1) > MAX_ALLOWED_ERROR or
+            sqlite3_column_double(select, 2) > MAX_ALLOWED_ERROR) {
+            failed = true;
+        }
+        if (sqlite3_column_int(select, 3) == 0) {
+            optimalScanPeriodFlag = false;
         }
     }
-    ss << "]";
-    ss >> stringCHS;
+    sqlite3_finalize(select);
 
-    ss2 << "{";
-    for (auto it = syncParameters.getPsr().begin(); it != syncParameters.getPsr().end();) {
-        ss2 << it->first <<":" << it->second;
-        if (++it != syncParameters.getPsr().end()) {
-            ss2 << ",";
-        }
+    if (rc != SQLITE_DONE) {
+        throwDBError();
     }
-    ss2 << "}";
-    ss2 >> stringPsr;
+}
 
+void M6SS::ModelValidator::finishRun(long runId, int result) {
+    sqlite3_stmt *update = nullptr;
+    if (sqlite3_prepare_v2(db, "UPDATE runs SET status = 'finished', result = ? WHERE runId = ?", -1, &update,
+                           nullptr) != SQLITE_OK or
+        sqlite3_bind_int(update, 1, result) != SQLITE_OK or
+        sqlite3_bind_int64(update, 2, runId) != SQLITE_OK or
+        sqlite3_step(update) != SQLITE_DONE) {
+        sqlite3_finalize(update);
+        throwDBError();
+    }
+    sqlite3_finalize(update);
+}
 
-    if (insertCounter % NUM_INSERTIONS_TO_CACHE == 0) {
-        char *err_msg = nullptr;
-        if (sqlite3_exec(db, "BEGIN TRANSACTION", nullptr, nullptr, &err_msg) != SQLITE_OK) {
-            std::string error = err_msg;
-            sqlite3_free(err_msg);
-            closeDBSession();
-            throw std::runtime_error(error);
+void M6SS::ModelValidator::throwDBError() {
+    std::string error = sqlite3_errmsg(db);
+    closeDBSession();
+    throw std::runtime_error(error);
+}
+
+void M6SS::ModelValidator::writeRecords(MPSCQueue<CaseResult> &records, const std::atomic<bool> &stopping,
+                                        ValidationMetrics *metrics) {
+    vector<CaseResult> rows; // the records of the next multi-row insert (fast mode)
+    rows.reserve(ROWS_PER_INSERT);
+
+    // executes a write to the database, measuring its latency
+    auto write = [metrics](long numRecords, auto &&operation) {
+        const auto start = std::chrono::steady_clock::now();
+        operation();
+        if (metrics) {
+            metrics->databaseWrite(numRecords, std::chrono::steady_clock::now() - start);
+        }
+    };
+    auto commitTransaction = [&write]() {
+        if (transactionOpen) {
+            write(0, commit);
+        }
+    };
+
+    while (true) {
+        // the flag is read before the queue is drained, so that the records pushed before the stop are not missed
+        bool stop = stopping;
+
+        while (std::optional<CaseResult> record = records.pop()) {
+            if (persistence == PersistenceMode::Default) {
+                write(1, [&record]() { save(*record); });
+                continue;
+            }
+
+            rows.push_back(std::move(*record));
+            if (rows.size() == ROWS_PER_INSERT) {
+                write(ROWS_PER_INSERT, [&rows]() { saveRows(rows); });
+                rows.clear();
+            }
+        }
+
+        if (persistence == PersistenceMode::Default) {
+            // the saved cases are committed whenever the queue runs dry, so that they are not repeated after a crash
+            commitTransaction();
+        } else {
+            // The saved cases are committed every COMMIT_INTERVAL (or every NUM_INSERTIONS_TO_CACHE rows, see
+            // saveRows), together with the rows of an incomplete multi-row insert, which start the interval if no
+            // transaction is open.
+            if (not rows.empty() and not transactionOpen) {
+                beginTransaction();
+            }
+            if (stop or (transactionOpen and std::chrono::steady_clock::now() - transactionStart >= COMMIT_INTERVAL)) {
+                for (const CaseResult &record: rows) {
+                    write(1, [&record]() { save(record); });
+                }
+                rows.clear();
+                commitTransaction();
+            }
         }
+
+        if (stop) {
+            return;
+        }
+        std::this_thread::sleep_for(1ms);
     }
+}
 
-    if (
-            sqlite3_bind_int(stmt, 1, syncParameters.getCHS().size()) != SQLITE_OK or
-            sqlite3_bind_text(stmt, 2, stringCHS.c_str(), -1, nullptr) != SQLITE_OK or
-            sqlite3_bind_int(stmt, 3, syncParameters.getS()) != SQLITE_OK or
-            sqlite3_bind_double(stmt, 4, syncParameters.getPeb()) != SQLITE_OK or
-            sqlite3_bind_double(stmt, 5, [&]() {
-                double sum = 0;
-                for (auto &element: syncParameters.getPsr()) { sum += element.second; }
-                return sum / syncParameters.getPsr().size();
-            }()) != SQLITE_OK or
-
-            sqlite3_bind_text(stmt, 6, stringPsr.c_str(), -1, nullptr) != SQLITE_OK or
-            sqlite3_bind_int64(stmt, 7, syncParameters.getTScan().count()) != SQLITE_OK or
-            sqlite3_bind_double(stmt, 8, relativeErrorInAVG) != SQLITE_OK or
-            sqlite3_bind_double(stmt, 9, maxAbsoluteErrorInCDF) != SQLITE_OK or
-            sqlite3_step(stmt) != SQLITE_DONE
-            ) {
+void M6SS::ModelValidator::save(const CaseResult &record) {
+    beginTransaction();
+
+    if (not bindRecord(stmt, 1, record) or sqlite3_step(stmt) != SQLITE_DONE) {
+        closeDBSession();
         throw std::runtime_error("Fail to bind arguments.");
 
     }
+    saveCDFs(record);
 
     insertCounter++;
 
     if (insertCounter % NUM_INSERTIONS_TO_CACHE == 0) {
-        char *err_msg = nullptr;
-        if (sqlite3_exec(db, "END TRANSACTION", nullptr, nullptr, &err_msg) != SQLITE_OK) {
-            std::string error = err_msg;
-            sqlite3_free(err_msg);
+        commit();
+    }
+
+    sqlite3_reset(stmt);
+}
+
+void M6SS::ModelValidator::saveRows(const vector<CaseResult> &records) {
+    beginTransaction();
+
+    for (int i = 0; i < ROWS_PER_INSERT; i++) {
+        if (not bindRecord(multiRowStmt, 1 + i * 15, records[i])) {
             closeDBSession();
-            throw std::runtime_error(error);
+            throw std::runtime_error("Fail to bind arguments.");
         }
     }
+    if (sqlite3_step(multiRowStmt) != SQLITE_DONE) {
+        throwDBError();
+    }
+    sqlite3_reset(multiRowStmt);
 
-    sqlite3_reset(stmt);
+    for (const CaseResult &record: records) {
+        saveCDFs(record);
+    }
+
+    insertCounter += ROWS_PER_INSERT;
+
+    if (insertCounter / NUM_INSERTIONS_TO_CACHE != (insertCounter - ROWS_PER_INSERT) / NUM_INSERTIONS_TO_CACHE) {
+        commit();
+    }
+}
+
+bool M6SS::ModelValidator::bindRecord(sqlite3_stmt *statement, int firstParameter, const CaseResult &record) {
+    const SyncParameters &syncParameters = record.syncParameters;
+    const int i = firstParameter;
+
+    bool bound;
+    if (persistence == PersistenceMode::Default) {
+        std::string stringCHS, stringPsr;
+        std::stringstream ss, ss2;
+        ss << "[";
+        for (auto it = syncParameters.getCHS().begin(); it != syncParameters.getCHS().end(); ++it) {
+            ss << *it;
+            if (it + 1 != syncParameters.getCHS().end()) {
+                ss << ",";
+            }
+        }
+        ss << "]";
+        ss >> stringCHS;
+
+        ss2 << "{";
+        for (auto it = syncParameters.getPsr().begin(); it != syncParameters.getPsr().end();) {
+            ss2 << it->first <<":" << it->second;
+            if (++it != syncParameters.getPsr().end()) {
+                ss2 << ",";
+            }
+        }
+        ss2 << "}";
+        ss2 >> stringPsr;
+
+        bound = sqlite3_bind_text(statement, i + 1, stringCHS.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK and
+                sqlite3_bind_text(statement, i + 5, stringPsr.c_str(), -1, SQLITE_TRANSIENT) == SQLITE_OK;
+    } else {
+        // a byte for each channel, and the (little-endian) double of the Psr of each channel, in the same order
+        std::string blobCHS, blobPsr;
+        for (int channel: syncParameters.getCHS()) {
+            blobCHS.push_back(static_cast<char>(channel));
+
+            uint64_t bits;
+            double psr = syncParameters.getPsr().at(channel);
+            std::memcpy(&bits, &psr, sizeof(bits));
+            for (int byte = 0; byte < 8; byte++) {
+                blobPsr.push_back(static_cast<char>(bits >> (8 * byte)));
+            }
+        }
+
+        bound = sqlite3_bind_blob(statement, i + 1, blobCHS.data(), static_cast<int>(blobCHS.size()),
+                                  SQLITE_TRANSIENT) == SQLITE_OK and
+                sqlite3_bind_blob(statement, i + 5, blobPsr.data(), static_cast<int>(blobPsr.size()),
+                                  SQLITE_TRANSIENT) == SQLITE_OK;
+    }
+
+    return bound and
+           sqlite3_bind_int(statement, i, syncParameters.getCHS().size()) == SQLITE_OK and
+           sqlite3_bind_int(statement, i + 2, syncParameters.getS()) == SQLITE_OK and
+           sqlite3_bind_double(statement, i + 3, syncParameters.getPeb()) == SQLITE_OK and
+           sqlite3_bind_double(statement, i + 4, [&]() {
+               double sum = 0;
+               for (auto &element: syncParameters.getPsr()) { sum += element.second; }
+               return sum / syncParameters.getPsr().size();
+           }()) == SQLITE_OK and
+           sqlite3_bind_int64(statement, i + 6, syncParameters.getTScan().count()) == SQLITE_OK and
+           sqlite3_bind_double(statement, i + 7, record.relativeErrorInAVG) == SQLITE_OK and
+           sqlite3_bind_double(statement, i + 8, record.maxAbsoluteErrorInCDF) == SQLITE_OK and
+           sqlite3_bind_int64(statement, i + 9, record.runId) == SQLITE_OK and
+           sqlite3_bind_int(statement, i + 10, record.flow) == SQLITE_OK and
+           sqlite3_bind_int64(statement, i + 11, record.caseIndex) == SQLITE_OK and
+           sqlite3_bind_int64(statement, i + 12, static_cast<sqlite3_int64>(record.seed)) == SQLITE_OK and
+           sqlite3_bind_int(statement, i + 13, record.optimalScanPeriodValid) == SQLITE_OK and
+           sqlite3_bind_int64(statement, i + 14, record.numSamples) == SQLITE_OK;
+}
+
+void M6SS::ModelValidator::saveCDFs(const CaseResult &record) {
+    if (record.modelCDF.empty()) {
+        return;
+    }
+
+    if (sqlite3_bind_int64(cdfStmt, 1, record.runId) != SQLITE_OK or
+        sqlite3_bind_int(cdfStmt, 2, record.flow) != SQLITE_OK or
+        sqlite3_bind_int64(cdfStmt, 3, record.caseIndex) != SQLITE_OK or
+        sqlite3_bind_blob(cdfStmt, 4, record.modelCDF.data(), static_cast<int>(record.modelCDF.size()),
+                          SQLITE_STATIC) != SQLITE_OK or
+        sqlite3_bind_blob(cdfStmt, 5, record.simulatorCDF.data(), static_cast<int>(record.simulatorCDF.size()),
+                          SQLITE_STATIC) != SQLITE_OK or
+        sqlite3_step(cdfStmt) != SQLITE_DONE) {
+        throwDBError();
+    }
+    sqlite3_reset(cdfStmt);
+}
+
+void M6SS::ModelValidator::beginTransaction() {
+    if (transactionOpen) {
+        return;
+    }
+
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, "BEGIN TRANSACTION", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::string error = err_msg;
+        sqlite3_free(err_msg);
+        closeDBSession();
+        throw std::runtime_error(error);
+    }
+    transactionOpen = true;
+    transactionStart = std::chrono::steady_clock::now();
+}
+
+void M6SS::ModelValidator::commit() {
+    if (not transactionOpen) {
+        return;
+    }
+
+    char *err_msg = nullptr;
+    if (sqlite3_exec(db, "END TRANSACTION", nullptr, nullptr, &err_msg) != SQLITE_OK) {
+        std::string error = err_msg;
+        sqlite3_free(err_msg);
+        closeDBSession();
+        throw std::runtime_error(error);
+    }
+    transactionOpen = false;
 }
 
 void M6SS::ModelValidator::closeDBSession() {
     char *err_msg = nullptr;
 
-    if (insertCounter % NUM_INSERTIONS_TO_CACHE != 0) { // check if a transaction is open
+    if (transactionOpen) {
         sqlite3_exec(db, "END TRANSACTION", nullptr, nullptr, &err_msg);
+        transactionOpen = false;
     }
 
     sqlite3_finalize(stmt);
+    sqlite3_finalize(multiRowStmt);
+    sqlite3_finalize(cdfStmt);
     sqlite3_close(db);
 
     if (err_msg) {
         std::string error = err_msg;
         sqlite3_free(err_msg);
-        throw std::runtime_error(err_msg);
+        throw std::runtime_error(error);
     }
 
 }
@@ -402,4 +1192,16 @@ double M6SS::ModelValidator::custom_real_n_distribution<Realtype>::operator()(Ge
         return uniform_real_distribution<Realtype>(a_, b_)(g);
     }
 
+}
+
+template<class Realtype>
+Realtype M6SS::ModelValidator::custom_real_n_distribution<Realtype>::operator()(double branch, double value,
+                                                                               double fraction) const {
+    if (branch < 0.5) {
+        long long first = static_cast<long long>(std::ceil(a_)), last = static_cast<long long>(std::floor(b_));
+        return first + static_cast<long long>(value * (last - first + 1))
+               + std::pow(2, -(1 + static_cast<int>(fraction * 4)));
+    } else {
+        return a_ + value * (b_ - a_);
+    }
 }
\ No newline at end of file
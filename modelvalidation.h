@@ -18,21 +18,72 @@
 #define M6SS_MODELVALIDATION_H
 
 #include <sqlite3.h>
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <optional>
+#include "syncparameters.h"
+#include "mpscqueue.h"
+#include "threadpool.h"
+#include "cancellationtoken.h"
+#include "cdfcodec.h"
+#include "validationmetrics.h"
+#include "sobolsequence.h"
 
 namespace M6SS {
 
     /**
      * This class makes an informal validation of the model by comparing it with the results of the simulator.
-     * In this direction, we use a huge sample on the simulator side (by default 1000000 samples are taken).
+     * In this direction, we use a huge sample on the simulator side (by default up to 1000000 samples are taken). The
+     * sample of a case grows in stages until the confidence intervals of the errors decide whether the case passes
+     * or fails (see decide), so the cases where the model and the simulator clearly agree (or disagree) stop early.
      * The comparison takes places for a large number of random cases (by default 100000) for each of the flows of the
      * model. Each random case is a random selection of the synchronization parameters (see SyncParameters class), except
      * the channel switching delay, which is assumed to be negligible.
      * Furthermore, during the validation of the model, each random case is compared to the same case but with the
      * scan period found optimal through our analysis (i.e., C slotframes, where C the number of available channels).
+     *
+     * A validation is a run, with an id, a random seed and a design (see CaseDesign), that is recorded in the database
+     * together with each case it completes. The parameters of each case are generated from a seed that is derived from
+     * the seed of the run, the flow and the index of the case (and, in a Sobol design, from the point of the case), so
+     * a run that was interrupted (e.g., by a crash) is resumed by the next call of makeValidation, which skips the
+     * completed cases and generates exactly the same remaining ones, and any case can be replayed by its id (see
+     * replayCase).
      */
     class ModelValidator {
     public:
 
+        /**
+         * The way in which the statistics of the cases are stored in the database.
+         * - Default: the rollback journal of SQLite, with its default synchronous setting, a row per insert, a commit
+         *   whenever the writer has no more records to save, and the channels (chs) and their Psr values (Psr) as
+         *   readable text, e.g., [11,15] and {11:0.5,15:0.25}.
+         * - Fast: write-ahead logging with synchronous=NORMAL, ROWS_PER_INSERT rows per insert, a commit every
+         *   NUM_INSERTIONS_TO_CACHE rows or COMMIT_INTERVAL, and the channels and their Psr values as BLOBs, i.e., a
+         *   byte for each channel and the little-endian IEEE 754 double of the Psr of each channel, in the order of
+         *   the channels. A crash may lose the cases of the last COMMIT_INTERVAL, which are repeated when the run is
+         *   resumed.
+         */
+        enum class PersistenceMode {
+            Default, Fast
+        };
+
+        /**
+         * The way in which the parameters of the cases are selected.
+         * - Random: each case is an independent random selection of the parameters.
+         * - Sobol: the number of channels, the number of slots, pEB, the average Psr, n (with the kind of its value in
+         *   flow 3) and Teb of the cases of each flow are given by the points of a scrambled Sobol sequence (see
+         *   SobolSequence), so that they cover the space of the parameters (including its corners) much more evenly
+         *   than independent selections, and a given coverage needs far fewer cases. The channels and their individual
+         *   Psr values are still selected randomly.
+         */
+        enum class CaseDesign {
+            Random = 0, Sobol = 1
+        };
+
         /**
          * Make the aforementioned comparisons and returns:
          * -1 if the model is not valid,
@@ -42,42 +93,211 @@ namespace M6SS {
          * We note that the model is considered valid if the difference between the model and the simulator is
          * negligible (by default lower than 1%).
          * Detailed information about the comparisons that took place between the model and the simulator are stored in
-         * an SQLite database named modelvalidation.db.
+         * an SQLite database named modelvalidation.db. If the last run in the database has not finished, it is
+         * resumed, otherwise a new run is started. The throughput and the progress of the validation, with an
+         * estimate of the remaining time, are written to the file modelvalidation.metrics.json every 10 seconds.
          * @param numThreads the number of threads to use for the computations.
+         * @param persistenceMode the way in which the statistics are stored (see PersistenceMode).
+         * @param cdfEncoding if given, the cdfs of the model and the simulator of each case are also stored, encoded
+         * in this way (see CDFCodec), in the table cdfs of the database, so that a suspicious case can be investigated
+         * without repeating its simulation.
+         * @param caseDesign the way in which the parameters of the cases of a new run are selected; a resumed run keeps
+         * its own.
+         * @param flows the flows to examine (see NUM_FLOWS), whose cases are examined together. The run is finished
+         * only once the model has failed or all the cases of all the flows have been examined, so a run can be split
+         * into calls for different flows, and the result refers to the given flows.
          * @return  -1 if the model is not considered valid, or, 0 if the model is considered valid but the scan period
          * that we found optimal through our analysis is not actually optimal, otherwise  (i.e., if both the model and
          * the scan period that we found optimal through our analysis are valid) returns 1.
-         * @throw std::invalid_argument if numThreads is less than 1.
+         * @throw std::invalid_argument if numThreads is less than 1, or, if flows is empty or contains a flow out of
+         * the range [1, NUM_FLOWS].
+         */
+        static int makeValidation(int numThreads = 1, PersistenceMode persistenceMode = PersistenceMode::Default,
+                                  std::optional<CDFCodec::Encoding> cdfEncoding = std::nullopt,
+                                  CaseDesign caseDesign = CaseDesign::Random, const std::set<int> &flows = {1, 2, 3});
+
+        /* the number of the flows of the model, which are numbered as follows: 1 for n in (0,1), 2 for n in N*, and 3
+         * for n real greater than 1 and not integer */
+        static constexpr int NUM_FLOWS = 3;
+
+        /**
+         * The outcome of a case of the validation.
          */
-        static int makeValidation(int numThreads = 1);
+        struct CaseResult {
+            long runId;
+            int flow;
+            long caseIndex;
+            uint64_t seed; // the seed from which the parameters and the simulation samples of the case are generated
+            SyncParameters syncParameters;
+            double relativeErrorInAVG = 0;
+            double maxAbsoluteErrorInCDF = 0;
+            bool optimalScanPeriodValid = true;
+            long numSamples = 0; // the number of the simulation samples that were needed for a decision
+            std::vector<unsigned char> modelCDF, simulatorCDF; // the encoded cdfs (see CDFCodec), if they are kept
+
+            /**
+             * Creates the outcome of a case that has not been examined yet, i.e., without errors and cdfs.
+             */
+            CaseResult(long runId, int flow, long caseIndex, uint64_t seed, SyncParameters syncParameters);
+
+            /**
+             * Returns true if the difference between the model and the simulator is negligible.
+             */
+            [[nodiscard]] bool passed() const;
+        };
+
+        /**
+         * Repeats a case of a run (e.g., a failing one), with exactly the same parameters and simulation samples
+         * (which are drawn from seeds derived from the seed of the case), so that its errors and its number of samples
+         * are the same as those that were stored, for any number of threads. The new results are not stored in the
+         * database; the cdfs of the model and the simulator are returned in the Float encoding.
+         * @param runId the id of the run.
+         * @param flow the flow of the case, in the range [1, NUM_FLOWS].
+         * @param caseIndex the index of the case in the flow, in the range [0, NUM_RANDOM_CASES).
+         * @param numThreads the number of threads to use for the computations.
+         * @return the outcome of the case.
+         * @throw std::invalid_argument if numThreads is less than 1, if flow or caseIndex is out of range, or, if there
+         * is no run with the given id.
+         */
+        static CaseResult replayCase(long runId, int flow, long caseIndex, int numThreads = 1);
 
     private:
 
+        /* Makes the calculations and the simulations of the cases returned by nextCase on the pool, fills in their
+         * errors and calls onCaseFinished for each case as soon as it is evaluated, from a thread of the pool. Up to
+         * NUM_CASES_IN_FLIGHT cases are in progress at a time, and nextCase, which is called under a lock, is asked
+         * for the next case as soon as one is finished, until it returns nothing or the token is cancelled. If the
+         * token is cancelled, the cases that have not been evaluated yet are abandoned. If a task throws any other
+         * exception, the token is cancelled and the exception is rethrown once the tasks in progress have stopped. If
+         * cdfEncoding is given, the cdfs of the model and the simulator are encoded into the results of the cases. The
+         * simulations and the evaluations of the model are counted in the given metrics, if any. */
+        static void runCases(const std::function<std::optional<CaseResult>()> &nextCase, ThreadPool &pool,
+                             CancellationToken &cancellation,
+                             const std::function<void(const CaseResult &)> &onCaseFinished,
+                             std::optional<CDFCodec::Encoding> cdfEncoding = std::nullopt,
+                             ValidationMetrics *metrics = nullptr);
+
+        enum class Decision {
+            Pass, Fail, Undecided
+        };
+
+        /* Decides, with confidence DECISION_CONFIDENCE, whether the errors between the model and the simulator are
+         * lower than MAX_ALLOWED_ERROR, given the current sample of the simulator. The relative error in the average
+         * synchronization time is bounded through the confidence interval of the mean (central limit theorem), and
+         * the max absolute error in cdf through the band of the Dvoretzky-Kiefer-Wolfowitz inequality. */
+        static Decision decide(double modelAvg, double simAvg, double simStdDev, double maxAbsoluteErrorInCDF,
+                               long numSamples);
+
+        static uint64_t caseSeed(uint64_t runSeed, int flow, long caseIndex);
+
+        /* Returns the seed of the simulation of a chunk of the samples of a case (see Simulator::run), so that the
+         * samples, and thus the decision after each stage, are the same in every execution of the case. */
+        static uint64_t chunkSeed(uint64_t caseSeed, long chunk);
+
+        static SyncParameters randomCase(int flow, uint64_t seed);
+
+        /* Creates the parameters of a case of a run, in the way of the given design. */
+        static SyncParameters designCase(CaseDesign caseDesign, int flow, uint64_t runSeed, long caseIndex);
+
+        template<class Distribution>
+        static SyncParameters randomCase(Distribution tScanDistribution, uint64_t seed);
+
+        /* Creates the parameters of a case from a point of a low-discrepancy design (see CaseDesign), with the same
+         * distributions as randomCase. */
+        static SyncParameters sobolCase(int flow, const SobolSequence &design, long caseIndex, uint64_t seed);
+
+        /* Creates a case with the given parameters and channels with the given average Psr; the channels and their Psr
+         * values are selected randomly, through generators derived from the seed. */
+        static SyncParameters makeCase(int c, int s, double pEB, double targetAveragePsr, double n,
+                                       std::chrono::nanoseconds tEB, uint64_t seed);
+
         /********************************* Sqlite3-Related Functions and Variables ****************/
 
-        static void prepareDBSession();
+        static void prepareDBSession(PersistenceMode mode = PersistenceMode::Default);
+
+        /* Finds the last run that has not finished, or starts a new one with a random seed and the given design. */
+        static void beginRun(long &runId, uint64_t &seed, CaseDesign &caseDesign);
+
+        /* Loads the cases of a flow that the run has completed, and whether any of them failed or found the optimal
+         * scan period not actually optimal. */
+        static void loadProgress(long runId, int flow, std::set<long> &completedCases, bool &failed,
+                                 bool &optimalScanPeriodFlag);
+
+        static void finishRun(long runId, int result);
+
+        [[noreturn]] static void throwDBError();
+
+        /* Saves the outcomes of the cases, which the workers push to the queue, until stopping is set and the queue is
+         * empty; it runs in a single writer thread, so that the workers never wait for each other or for the
+         * database. The latency of each write is counted in the given metrics, if any. */
+        static void writeRecords(MPSCQueue<CaseResult> &records, const std::atomic<bool> &stopping,
+                                 ValidationMetrics *metrics = nullptr);
+
+        static void save(const CaseResult &record);
 
-        static void save(const SyncParameters &syncParameters, double relativeErrorInAVG, double maxAbsoluteErrorInCDF);
+        /* Saves ROWS_PER_INSERT records with a single insert. */
+        static void saveRows(const std::vector<CaseResult> &records);
+
+        /* Binds the columns of a record to the parameters of an insert, starting from the given one. */
+        static bool bindRecord(sqlite3_stmt *statement, int firstParameter, const CaseResult &record);
+
+        /* Saves the cdfs of a record, if it has them. */
+        static void saveCDFs(const CaseResult &record);
+
+        static void beginTransaction();
+
+        static void commit();
 
         static void closeDBSession();
 
         static inline sqlite3 *db = nullptr;
         static inline sqlite3_stmt *stmt = nullptr;
+        static inline sqlite3_stmt *multiRowStmt = nullptr; // the insert of ROWS_PER_INSERT rows (fast mode)
+        static inline sqlite3_stmt *cdfStmt = nullptr; // the insert of the cdfs of a case
+        static inline PersistenceMode persistence = PersistenceMode::Default;
+        static inline std::chrono::steady_clock::time_point transactionStart;
         static inline long insertCounter = 0;
-        static constexpr long NUM_INSERTIONS_TO_CACHE = 100;
+        static inline bool transactionOpen = false;
+        static constexpr long NUM_INSERTIONS_TO_CACHE = 10000;
+        // the 15 parameters of each row stay within the limit of 999 parameters of older SQLite versions
+        static constexpr int ROWS_PER_INSERT = 32;
+        static constexpr std::chrono::seconds COMMIT_INTERVAL{1};
         /*****************************************************************************************/
 
+        /* the file of the metrics of a validation (see ValidationMetrics), which is rewritten every METRICS_INTERVAL */
+        static constexpr const char *METRICS_FILE = "modelvalidation.metrics.json";
+        static constexpr std::chrono::seconds METRICS_INTERVAL{10};
+
         /* the number of random cases to check for each of the flows of the model */
         static constexpr long NUM_RANDOM_CASES = 100000;
 
-        /* the number of the simulation samples to use in each case */
+        /* the max number of the simulation samples to use in each case */
         static constexpr long NUM_SIM_SAMPLES_PER_CASE = 1000000;
 
+        /* the number of the simulation samples of a task; the samples of a case are collected in chunks of this size,
+         * which are simulated in parallel and then merged (see Simulator::Results::merge) */
+        static constexpr long NUM_SIM_SAMPLES_PER_CHUNK = 25000;
+
+        static constexpr long NUM_SIM_CHUNKS_PER_CASE =
+                (NUM_SIM_SAMPLES_PER_CASE + NUM_SIM_SAMPLES_PER_CHUNK - 1) / NUM_SIM_SAMPLES_PER_CHUNK;
+
+        /* the coordinates of a case in a Sobol design: the number of channels, the number of slots, pEB, the average
+         * Psr, n, the kind of n and its fractional part in flow 3 (see custom_real_n_distribution), and Teb */
+        static constexpr int SOBOL_DIMENSIONS = 8;
+
+        /* the max number of cases in progress at a time (see runCases); a new case is started as soon as one is
+         * finished */
+        static constexpr long NUM_CASES_IN_FLIGHT = 256;
+
         /* MAX_ALLOWED_ERROR indicates the max allowed difference between the model and the simulator, in percent.
          * It is noted that, in the case of average synchronization time the relative error is taken into account, while
          * in the case of cdf the absolute error. */
         static constexpr double MAX_ALLOWED_ERROR = 0.01; // 1% MAX_ALLOWED_ERROR
 
+        /* the confidence with which each case is decided before all of its samples are simulated (see decide); the
+         * cases that are still undecided after NUM_SIM_SAMPLES_PER_CASE samples are decided by the errors themselves */
+        static constexpr double DECISION_CONFIDENCE = 0.999;
+
         /*
          * This is a custom real distribution that we use to create random values for n in the case where n is a real
          * number greater than 1 and is not an integer (i.e., the scan period is greater than the step, but is not an
@@ -95,6 +315,10 @@ namespace M6SS {
             template<class Generator>
             double operator()(Generator &g);
 
+            /* Returns the value of the distribution that corresponds to three coordinates in [0, 1) (e.g., of a point
+             * of a low-discrepancy design), which select the kind of the value, the value and its fractional part. */
+            Realtype operator()(double branch, double value, double fraction) const;
+
         private:
             Realtype a_, b_;
         };
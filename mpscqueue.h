@@ -0,0 +1,95 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_MPSCQUEUE_H
+#define M6SS_MPSCQUEUE_H
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace M6SS {
+
+    /**
+     * This class represents an unbounded lock-free queue with multiple producers and a single consumer (Vyukov's
+     * algorithm). A push is a single atomic exchange, so the producers never wait for each other or for the consumer.
+     * A pop may miss an element whose push is still in progress, in which case it will be returned by a later pop.
+     * @tparam T the type of the elements.
+     */
+    template<class T>
+    class MPSCQueue {
+    public:
+        MPSCQueue() : head_(new Node()), tail_(head_.load(std::memory_order_relaxed)) {}
+
+        /**
+         * Destroys the remaining elements. It is noted that no push must be in progress.
+         */
+        ~MPSCQueue() {
+            while (tail_ != nullptr) {
+                Node *next = tail_->next.load(std::memory_order_relaxed);
+                delete tail_;
+                tail_ = next;
+            }
+        }
+
+        MPSCQueue(const MPSCQueue &) = delete;
+
+        MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+        /**
+         * Adds an element at the back of the queue; it may be called by any thread.
+         */
+        void push(T value) {
+            Node *node = new Node(std::move(value));
+            Node *previous = head_.exchange(node, std::memory_order_acq_rel);
+            previous->next.store(node, std::memory_order_release);
+        }
+
+        /**
+         * Removes the element at the front of the queue; it must be called only by the consumer thread.
+         * @return the element, or nothing if the queue is empty.
+         */
+        std::optional<T> pop() {
+            Node *next = tail_->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return std::nullopt;
+            }
+
+            // the next node becomes the (empty) front node
+            std::optional<T> value = std::move(next->value);
+            next->value.reset();
+            delete tail_;
+            tail_ = next;
+            return value;
+        }
+
+    private:
+        struct Node {
+            std::atomic<Node *> next{nullptr};
+            std::optional<T> value;
+
+            Node() = default;
+
+            explicit Node(T value) : value(std::move(value)) {}
+        };
+
+        alignas(64) std::atomic<Node *> head_; // the last node, which is updated by the producers
+        alignas(64) Node *tail_; // the front (empty) node, which is updated only by the consumer
+    };
+
+}
+
+#endif //M6SS_MPSCQUEUE_H
@@ -0,0 +1,295 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "syncparameters.h"
+#include "threadpool.h"
+#include "parameteratlas.h"
+
+/* The layout of the file is: an AtlasHeader, the axes (c and s as 32-bit integers, padded to a multiple of 8 bytes,
+ * followed by pEB, avgPsr and n as doubles) and the values, i.e., log(avgSyncTime in seconds) as floats in the order
+ * c, s, pEB, avgPsr, n (n varies the fastest). All the values are stored in the native byte order. */
+namespace {
+    struct AtlasHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrderMark;
+        std::uint32_t numC, numS, numPeb, numPsr, numN;
+        std::uint32_t reserved;
+        std::int64_t tEB; // in nanoseconds
+        std::int64_t slotDuration; // in nanoseconds
+    };
+
+    constexpr char MAGIC[8] = {'M', '6', 'S', 'S', 'A', 'T', 'L', 'S'};
+    constexpr std::uint32_t VERSION = 1;
+    constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    /* the number of grid points that are calculated together (see Model::calculateBatch) */
+    constexpr size_t BUILD_CHUNK_SIZE = 1024;
+
+    template<class T>
+    void sortAndCheck(std::vector<T> &axis, const char *name, T min, T max, bool minIncluded) {
+        std::sort(axis.begin(), axis.end());
+        axis.erase(std::unique(axis.begin(), axis.end()), axis.end());
+        if (axis.empty()) {
+            throw std::invalid_argument(std::string("The axis ") + name + " of the grid is empty.");
+        }
+        if (axis.front() < min or (!minIncluded and axis.front() == min) or axis.back() > max) {
+            throw std::invalid_argument(std::string("The axis ") + name + " of the grid contains an invalid value.");
+        }
+    }
+
+    size_t alignTo8(size_t size) {
+        return (size + 7) / 8 * 8;
+    }
+}
+
+void M6SS::ParameterAtlas::build(const std::string &path, Grid grid, const Model::Options &options, ThreadPool &pool) {
+    sortAndCheck(grid.c, "c", 1, 16, true);
+    sortAndCheck(grid.s, "s", 0, std::numeric_limits<int>::max(), false);
+    sortAndCheck(grid.pEB, "pEB", 0.0, 1.0, false);
+    sortAndCheck(grid.avgPsr, "avgPsr", 0.0, 1.0, false);
+    sortAndCheck(grid.n, "n", 0.0, std::numeric_limits<double>::max(), false);
+    for (int c: grid.c) {
+        if (SyncParameters::DEFAULT_CHANNEL_HOPPING_SEQUENCES.count(c) == 0) {
+            throw std::invalid_argument("There is no default channel hopping sequence for a number of channels.");
+        }
+        for (int s: grid.s) {
+            if (std::gcd(c, s) != 1) {
+                throw std::invalid_argument("The numbers of slots must be co-primes with the numbers of channels.");
+            }
+        }
+    }
+
+    const size_t numPoints = grid.c.size() * grid.s.size() * grid.pEB.size() * grid.avgPsr.size() * grid.n.size();
+    std::vector<float> values(numPoints);
+
+    auto parametersOf = [&grid](size_t point) {
+        size_t iN = point % grid.n.size();
+        point /= grid.n.size();
+        size_t iPsr = point % grid.avgPsr.size();
+        point /= grid.avgPsr.size();
+        size_t iPeb = point % grid.pEB.size();
+        point /= grid.pEB.size();
+        size_t iS = point % grid.s.size();
+        size_t iC = point / grid.s.size();
+
+        const std::vector<int> &chs = SyncParameters::DEFAULT_CHANNEL_HOPPING_SEQUENCES.at(grid.c[iC]);
+        std::map<int, double> pSR;
+        for (int channel: chs) {
+            pSR[channel] = grid.avgPsr[iPsr];
+        }
+        auto tScan = std::chrono::round<std::chrono::nanoseconds>(
+                grid.n[iN] * grid.s[iS] * SyncParameters::DEFAULT_SLOT_DURATION
+        );
+        return SyncParameters(chs, grid.s[iS], grid.pEB[iPeb], pSR, tScan, std::chrono::nanoseconds(0), grid.tEB);
+    };
+
+    // the points are calculated in chunks, so that the memory for the cdfs of the results remains bounded
+    std::vector<SyncParameters> chunk;
+    std::vector<Model::Results> results;
+    for (size_t first = 0; first < numPoints; first += BUILD_CHUNK_SIZE) {
+        size_t last = std::min(numPoints, first + BUILD_CHUNK_SIZE);
+        chunk.clear();
+        for (size_t point = first; point < last; point++) {
+            chunk.push_back(parametersOf(point));
+        }
+
+        Model::calculateBatch(chunk, results, options, pool);
+        for (size_t point = first; point < last; point++) {
+            values[point] = std::log(results[point - first].avgSyncTime().count());
+        }
+    }
+
+    AtlasHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.numC = grid.c.size();
+    header.numS = grid.s.size();
+    header.numPeb = grid.pEB.size();
+    header.numPsr = grid.avgPsr.size();
+    header.numN = grid.n.size();
+    header.tEB = grid.tEB.count();
+    header.slotDuration = std::chrono::nanoseconds(SyncParameters::DEFAULT_SLOT_DURATION).count();
+
+    const std::string temporaryPath = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        auto write = [&file](const void *data, size_t size) {
+            file.write(static_cast<const char *>(data), size);
+        };
+
+        write(&header, sizeof(header));
+        std::vector<std::int32_t> integers(grid.c.begin(), grid.c.end());
+        integers.insert(integers.end(), grid.s.begin(), grid.s.end());
+        integers.resize(alignTo8(integers.size() * sizeof(std::int32_t)) / sizeof(std::int32_t), 0);
+        write(integers.data(), integers.size() * sizeof(std::int32_t));
+        write(grid.pEB.data(), grid.pEB.size() * sizeof(double));
+        write(grid.avgPsr.data(), grid.avgPsr.size() * sizeof(double));
+        write(grid.n.data(), grid.n.size() * sizeof(double));
+        write(values.data(), values.size() * sizeof(float));
+
+        file.close();
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("Fail to write the atlas " + temporaryPath + ".");
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        throw std::runtime_error("Fail to write the atlas " + path + ": " + std::strerror(errno));
+    }
+}
+
+void M6SS::ParameterAtlas::build(const std::string &path, const Grid &grid) {
+    build(path, grid, Model::Options(), ThreadPool::shared());
+}
+
+M6SS::ParameterAtlas::ParameterAtlas(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Fail to open the atlas " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 or st.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("The file " + path + " is not an atlas.");
+    }
+
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping remains valid
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("Fail to map the atlas " + path + ": " + std::strerror(errno));
+    }
+    map_ = static_cast<const unsigned char *>(map);
+    mapSize_ = st.st_size;
+
+    AtlasHeader header{};
+    size_t axesSize = 0;
+    if (mapSize_ >= sizeof(header)) {
+        std::memcpy(&header, map_, sizeof(header));
+        axesSize = alignTo8((size_t(header.numC) + header.numS) * sizeof(std::int32_t)) +
+                   (size_t(header.numPeb) + header.numPsr + header.numN) * sizeof(double);
+    }
+    size_t numPoints = size_t(header.numC) * header.numS * header.numPeb * header.numPsr * header.numN;
+    if (mapSize_ < sizeof(header) or std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 or
+        header.version != VERSION or header.byteOrderMark != BYTE_ORDER_MARK or numPoints == 0 or
+        mapSize_ != sizeof(header) + axesSize + numPoints * sizeof(float)) {
+        munmap(map, mapSize_);
+        throw std::runtime_error("The file " + path + " is not a (compatible) atlas.");
+    }
+
+    const unsigned char *p = map_ + sizeof(header);
+    auto read = [&p](auto &axis, size_t size) {
+        axis.resize(size);
+        std::memcpy(axis.data(), p, size * sizeof(axis[0]));
+        p += size * sizeof(axis[0]);
+    };
+    std::vector<std::int32_t> integers;
+    read(integers, alignTo8((size_t(header.numC) + header.numS) * sizeof(std::int32_t)) / sizeof(std::int32_t));
+    grid_.c.assign(integers.begin(), integers.begin() + header.numC);
+    grid_.s.assign(integers.begin() + header.numC, integers.begin() + header.numC + header.numS);
+    read(grid_.pEB, header.numPeb);
+    read(grid_.avgPsr, header.numPsr);
+    read(grid_.n, header.numN);
+    grid_.tEB = std::chrono::nanoseconds(header.tEB);
+
+    s_.assign(grid_.s.begin(), grid_.s.end());
+    values_ = reinterpret_cast<const float *>(p); // p is aligned to 8 bytes
+}
+
+M6SS::ParameterAtlas::~ParameterAtlas() {
+    munmap(const_cast<unsigned char *>(map_), mapSize_);
+}
+
+std::chrono::duration<double> M6SS::ParameterAtlas::avgSyncTime(int c, double s, double pEB, double avgPsr,
+                                                                double n) const {
+    auto itC = std::find(grid_.c.begin(), grid_.c.end(), c);
+    if (itC == grid_.c.end()) {
+        throw std::out_of_range("The number of channels is not included in the atlas.");
+    }
+
+    const std::vector<double> *axes[4] = {&s_, &grid_.pEB, &grid_.avgPsr, &grid_.n};
+    const double x[4] = {s, pEB, avgPsr, n};
+    size_t index[4];
+    double weight[4];
+    size_t stride[4];
+    size_t offset = itC - grid_.c.begin();
+    for (int d = 0; d < 4; d++) {
+        locate(*axes[d], x[d], index[d], weight[d]);
+        offset = offset * axes[d]->size() + index[d];
+    }
+    stride[3] = 1;
+    for (int d = 2; d >= 0; d--) {
+        stride[d] = stride[d + 1] * axes[d + 1]->size();
+    }
+
+    // interpolate over the 16 corners of the cell; a corner with zero weight is not read, so that the cell of the
+    // last value of an axis does not exceed the grid
+    double logTime = 0;
+    for (int corner = 0; corner < 16; corner++) {
+        double w = 1;
+        size_t cornerOffset = offset;
+        for (int d = 0; d < 4; d++) {
+            if (corner & (1 << d)) {
+                w *= weight[d];
+                cornerOffset += stride[d];
+            } else {
+                w *= 1 - weight[d];
+            }
+        }
+        if (w != 0) {
+            logTime += w * values_[cornerOffset];
+        }
+    }
+    return std::chrono::duration<double>(std::exp(logTime));
+}
+
+const M6SS::ParameterAtlas::Grid &M6SS::ParameterAtlas::getGrid() const {
+    return grid_;
+}
+
+void M6SS::ParameterAtlas::locate(const std::vector<double> &axis, double x, size_t &index, double &weight) {
+    if (!(x >= axis.front() and x <= axis.back())) {
+        throw std::out_of_range("A parameter is outside the grid of the atlas.");
+    }
+
+    if (axis.size() == 1) {
+        index = 0;
+        weight = 0;
+        return;
+    }
+
+    index = std::upper_bound(axis.begin(), axis.end(), x) - axis.begin();
+    index = std::min(std::max(index, size_t(1)), axis.size() - 1) - 1;
+    weight = (x - axis[index]) / (axis[index + 1] - axis[index]);
+}
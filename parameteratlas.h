@@ -0,0 +1,114 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_PARAMETERATLAS_H
+#define M6SS_PARAMETERATLAS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include "model.h"
+
+namespace M6SS {
+
+    class ThreadPool; // forward declaration
+
+    /**
+     * This class represents an atlas of the average synchronization time, i.e., the results of the model over a grid
+     * of (C, S, Peb, average Psr, n), where C is the number of channels (with the default channel hopping sequence of
+     * SyncParameters), S is the number of slots, n = Tscan / Tsf, and all the channels have the same Psr. The atlas is
+     * built once (see build) into a binary file, which is then memory-mapped, so that the average synchronization time
+     * for any point inside the grid is estimated, through multilinear interpolation, in a fraction of a microsecond.
+     */
+    class ParameterAtlas {
+    public:
+        /**
+         * The grid of an atlas. The values of each axis are sorted and the duplicates are removed by build.
+         */
+        struct Grid {
+            std::vector<int> c; // the numbers of channels, which are not interpolated
+            std::vector<int> s; // the numbers of slots, which must be co-primes with all the numbers of channels
+            std::vector<double> pEB; // in (0, 1]
+            std::vector<double> avgPsr; // in (0, 1]
+            std::vector<double> n; // the values of Tscan / Tsf, greater than zero
+            std::chrono::nanoseconds tEB = std::chrono::microseconds(4256);
+        };
+
+        /**
+         * Evaluates the model at each point of a grid in parallel and writes the atlas to a file. The file is written
+         * under a temporary name and then renamed, so an existing atlas is replaced atomically.
+         * @param path the path of the atlas.
+         * @param grid the grid.
+         * @param options the options of the calculations.
+         * @param pool the thread pool that makes the calculations.
+         * @throw std::invalid_argument if an axis is empty or contains an invalid value, or if a number of slots and
+         * a number of channels are not co-primes.
+         * @throw std::runtime_error if the file cannot be written.
+         */
+        static void build(const std::string &path, Grid grid, const Model::Options &options, ThreadPool &pool);
+
+        /**
+         * The same as the function above, but the calculations are made by the shared thread pool with the default
+         * options.
+         */
+        static void build(const std::string &path, const Grid &grid);
+
+        /**
+         * Opens an atlas.
+         * @param path the path of the atlas.
+         * @throw std::runtime_error if the file cannot be opened or is not an atlas.
+         */
+        explicit ParameterAtlas(const std::string &path);
+
+        ParameterAtlas(const ParameterAtlas &) = delete;
+
+        ParameterAtlas &operator=(const ParameterAtlas &) = delete;
+
+        ~ParameterAtlas();
+
+        /**
+         * Estimates the average synchronization time. The estimation interpolates the logarithm of the average
+         * synchronization time multilinearly over s, pEB, avgPsr and n, since the time varies over orders of magnitude.
+         * @param c the number of channels, which must be a value of the grid.
+         * @param s the number of slots.
+         * @param pEB the probability of an EB transmission.
+         * @param avgPsr the probability of the successful reception of an EB (in all the channels).
+         * @param n the ratio Tscan / Tsf.
+         * @return the estimated average synchronization time.
+         * @throw std::out_of_range if c is not a value of the grid, or if a parameter is outside the grid.
+         */
+        [[nodiscard]] std::chrono::duration<double> avgSyncTime(int c, double s, double pEB, double avgPsr,
+                                                                double n) const;
+
+        /**
+         * Returns the grid of the atlas.
+         */
+        [[nodiscard]] const Grid &getGrid() const;
+
+    private:
+        /* Finds the grid interval of the value x and the position of x in it. */
+        static void locate(const std::vector<double> &axis, double x, size_t &index, double &weight);
+
+        Grid grid_;
+        std::vector<double> s_; // the numbers of slots as doubles, for the interpolation
+        const unsigned char *map_ = nullptr;
+        size_t mapSize_ = 0;
+        const float *values_ = nullptr; // log(avgSyncTime in seconds), in the order c, s, pEB, avgPsr, n
+    };
+
+}
+
+#endif //M6SS_PARAMETERATLAS_H
@@ -0,0 +1,93 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <algorithm>
+#include "parameterbatch.h"
+
+M6SS::ParameterBatch::ParameterBatch(const std::vector<int> &chs, int s, const std::chrono::nanoseconds &tScan,
+                                     const std::chrono::nanoseconds &tSwitch, const std::chrono::nanoseconds &tEB) {
+    // validate the shared parameters through a parameter set with valid probabilities
+    std::map<int, double> pSR;
+    for (int channel: chs) {
+        pSR[channel] = 1;
+    }
+    SyncParameters(chs, s, 1, pSR, tScan, tSwitch, tEB);
+
+    chs_ = chs;
+    s_ = s;
+    tScan_ = tScan;
+    tSwitch_ = tSwitch;
+    tEB_ = tEB;
+    pSR_.resize(chs.size());
+}
+
+void M6SS::ParameterBatch::add(double pEB, const std::map<int, double> &pSR) {
+    SyncParameters(chs_, s_, pEB, pSR, tScan_, tSwitch_, tEB_); // validate the probabilities
+
+    pEB_.push_back(pEB);
+    for (size_t i = 0; i < chs_.size(); i++) {
+        pSR_[i].push_back(pSR.at(chs_[i]));
+    }
+}
+
+size_t M6SS::ParameterBatch::size() const {
+    return pEB_.size();
+}
+
+const std::vector<int> &M6SS::ParameterBatch::getCHS() const {
+    return chs_;
+}
+
+int M6SS::ParameterBatch::getS() const {
+    return s_;
+}
+
+const std::chrono::nanoseconds &M6SS::ParameterBatch::getTScan() const {
+    return tScan_;
+}
+
+const std::chrono::nanoseconds &M6SS::ParameterBatch::getTSwitch() const {
+    return tSwitch_;
+}
+
+const std::chrono::nanoseconds &M6SS::ParameterBatch::getTeb() const {
+    return tEB_;
+}
+
+const std::vector<double> &M6SS::ParameterBatch::getPebColumn() const {
+    return pEB_;
+}
+
+const std::vector<double> &M6SS::ParameterBatch::getPsrColumn(int channel) const {
+    auto it = std::find(chs_.begin(), chs_.end(), channel);
+    if (it == chs_.end()) {
+        throw std::out_of_range("The channel is not included in the channel hopping sequence.");
+    }
+    return pSR_[it - chs_.begin()];
+}
+
+M6SS::SyncParameters M6SS::ParameterBatch::at(size_t index) const {
+    if (index >= size()) {
+        throw std::out_of_range("index is out of range.");
+    }
+
+    std::map<int, double> pSR;
+    for (size_t i = 0; i < chs_.size(); i++) {
+        pSR[chs_[i]] = pSR_[i][index];
+    }
+    return SyncParameters(chs_, s_, pEB_[index], pSR, tScan_, tSwitch_, tEB_);
+}
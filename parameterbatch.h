@@ -0,0 +1,116 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_PARAMETERBATCH_H
+#define M6SS_PARAMETERBATCH_H
+
+#include <chrono>
+#include <vector>
+#include <map>
+#include "syncparameters.h"
+
+namespace M6SS {
+
+    /**
+     * This class represents a batch of synchronization parameters that share the channel hopping sequence, the number
+     * of slots and the times (i.e., Tscan, Tswitch and Teb), and differ only in the probabilities Peb and Psr. The
+     * shared parameters are stored once, while the probabilities are stored in a structure-of-arrays layout, i.e., in
+     * a contiguous column for Peb and for the Psr of each channel. This layout allows the model to evaluate many
+     * parameter sets at once (see Model::calculateBatch).
+     */
+    class ParameterBatch {
+    public:
+        /**
+         * Initializes a new, empty instance of the ParameterBatch class.
+         * @param chs the channel hopping sequence.
+         * @param s the number of slots in the slotframe.
+         * @param tScan the time that a selected channel is scanned for an EB.
+         * @param tSwitch the channel switch delay.
+         * @param tEB the time required for the transmission of an EB.
+         * @throw std::invalid_argument if the parameters are not valid (see the constructor of SyncParameters).
+         */
+        ParameterBatch(const std::vector<int> &chs, int s, const std::chrono::nanoseconds &tScan,
+                       const std::chrono::nanoseconds &tSwitch, const std::chrono::nanoseconds &tEB);
+
+        /**
+         * Adds a parameter set to the batch.
+         * @param pEB the probability of an EB transmission (in the minimal cell).
+         * @param pSR a map that contains for each channel in chs the probability of the successful reception of an EB.
+         * @throw std::invalid_argument if pEB or pSR are not valid (see the constructor of SyncParameters).
+         */
+        void add(double pEB, const std::map<int, double> &pSR);
+
+        /**
+         * Returns the number of parameter sets in the batch.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Returns the channel hopping sequence of the batch.
+         */
+        [[nodiscard]] const std::vector<int> &getCHS() const;
+
+        /**
+         * Returns the number of slots in the slotframe.
+         */
+        [[nodiscard]] int getS() const;
+
+        /**
+         * Returns the time that a selected channel is scanned for an EB.
+         */
+        [[nodiscard]] const std::chrono::nanoseconds &getTScan() const;
+
+        /**
+         * Returns the channel switch delay.
+         */
+        [[nodiscard]] const std::chrono::nanoseconds &getTSwitch() const;
+
+        /**
+         * Returns the time required for the transmission of an EB.
+         */
+        [[nodiscard]] const std::chrono::nanoseconds &getTeb() const;
+
+        /**
+         * Returns the column with the probability Peb of each parameter set.
+         */
+        [[nodiscard]] const std::vector<double> &getPebColumn() const;
+
+        /**
+         * Returns the column with the probability Psr of a channel for each parameter set.
+         * @param channel the channel.
+         * @throw std::out_of_range if the channel is not included in the channel hopping sequence.
+         */
+        [[nodiscard]] const std::vector<double> &getPsrColumn(int channel) const;
+
+        /**
+         * Returns a parameter set of the batch as a SyncParameters object.
+         * @param index the index of the parameter set.
+         * @throw std::out_of_range if index is not less than size().
+         */
+        [[nodiscard]] SyncParameters at(size_t index) const;
+
+    private:
+        std::vector<int> chs_;
+        int s_;
+        std::chrono::nanoseconds tScan_, tSwitch_, tEB_;
+
+        std::vector<double> pEB_;
+        std::vector<std::vector<double> > pSR_; // a column for each channel, in the order of chs
+    };
+
+}
+
+#endif //M6SS_PARAMETERBATCH_H
@@ -0,0 +1,330 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+#include "psynckernel.h"
+#include "simd.h"
+#include "dual.h"
+
+namespace {
+
+    /**
+     * Calculates the tail of the distribution of the number of steps after K steps.
+     * @param pStep, pNoReception the probabilities for each position of W (see PsyncKernel).
+     * @param remaining for each y, the probability that the synchronization requires more than K steps.
+     */
+    M6SS::PsyncTail calculateTail(int C, long n, size_t K, const double *pStep, const double *pNoReception,
+                                  const double *remaining) {
+        // The scan periods of the lane y start at the channel offsets (y + (i - 1) * n) mod C, which repeat every C
+        // scan periods. Hence, the probability that the lane does not synchronize decreases by a constant factor
+        // rho(y) every w = n * C steps, and the sum of k * Psync(k|y) for k > K is at most
+        // R(y) * (K + w / (1 - rho(y))), where R(y) is the probability that the lane does not synchronize within the
+        // first K steps.
+        double Qsp[M6SS::PsyncKernel<double>::MAX_LANES]; // Qsp for a scan period that starts at each channel offset
+        for (int offset = 0; offset < C; offset++) {
+            double sum = 0;
+            for (int i = 0; i < C; i++) {
+                long firstUse = ((i - offset) % C + C) % C; // the first step of the scan period that uses W(i+1)
+                if (firstUse >= n) {
+                    continue;
+                }
+                long uses = (n - 1 - firstUse) / C + 1;
+                double r = pNoReception[i];
+                // the geometric sum of Pstep * r^Nchp for Nchp = 0, ..., uses - 1
+                sum += r == 1 ? 0 : pStep[i] * (1 - std::pow(r, uses)) / (1 - r);
+            }
+            Qsp[offset] = 1 - sum;
+        }
+
+        M6SS::PsyncTail tail{0, 0};
+        const double w = static_cast<double>(n) * C;
+        for (int y = 0; y < C; y++) {
+            double rho = 1;
+            for (int j = 0; j < C; j++) {
+                rho *= Qsp[(y + j * (n % C)) % C];
+            }
+            tail.mass += remaining[y] / C;
+            if (remaining[y] > 0) {
+                tail.stepsBound += remaining[y] * (K + w / (1 - rho)) / C;
+            }
+        }
+
+        return tail;
+    }
+
+}
+
+template<class Real>
+M6SS::PsyncKernel<Real>::PsyncKernel(const std::vector<Real> &pStep, const std::vector<Real> &pNoReception,
+                                     long n) {
+    if (pStep.size() != pNoReception.size() or pStep.empty() or pStep.size() > MAX_LANES) {
+        throw std::invalid_argument("pStep and pNoReception must have the same size, in the range [1, 16].");
+    }
+
+    if (n <= 0) {
+        throw std::invalid_argument("n must be greater than 0.");
+    }
+
+    C_ = pStep.size();
+    n_ = n;
+
+    constexpr int width = simd::Vec<Real>::WIDTH;
+    lanes_ = (C_ + width - 1) / width * width;
+
+    for (int i = 0; i < C_; i++) {
+        pStep_[i] = pStep[i];
+        pNoReception_[i] = pNoReception[i];
+        factor_[i] = 1;
+        survival_[i] = 1; // the padding lanes keep a zero survival, so that they do not contribute to Psync
+    }
+
+    refreshStepProbabilities();
+}
+
+template<class Real>
+Real M6SS::PsyncKernel<Real>::next() {
+    using V = simd::Vec<Real>;
+
+    long t = step_ % n_; // the position of the step within the scan period (zero based)
+    if (t == 0) {
+        if (scaled_) { // a new scan period begins; Nchp = 0
+            for (int i = 0; i < C_; i++) {
+                factor_[i] = 1;
+            }
+            scaled_ = false;
+            refreshStepProbabilities();
+        }
+    } else if (t % C_ == 0) { // Nchp increases by one
+        for (int i = 0; i < C_; i++) {
+            factor_[i] *= pNoReception_[i];
+        }
+        scaled_ = true;
+        refreshStepProbabilities();
+    }
+
+    // the lane y uses the channel X(k, y) = W((y + k - 1) mod C + 1)
+    const Real *pStepSp = rotated_ + step_ % C_;
+    V psync = V::broadcast(0);
+    for (int l = 0; l < lanes_; l += V::WIDTH) {
+        V p = V::load(pStepSp + l);
+        psync = psync + V::load(survival_ + l) * p;
+        (V::load(periodSum_ + l) + p).store(periodSum_ + l);
+    }
+
+    if (t == n_ - 1) { // the scan period ends; multiply the survival of each lane by Qsp
+        const V one = V::broadcast(1), zero = V::broadcast(0);
+        for (int l = 0; l < lanes_; l += V::WIDTH) {
+            (V::load(survival_ + l) * (one - V::load(periodSum_ + l))).store(survival_ + l);
+            zero.store(periodSum_ + l);
+        }
+    }
+
+    step_++;
+    return psync.reduceAdd() / C_;
+}
+
+template<class Real>
+size_t M6SS::PsyncKernel<Real>::steps() const {
+    return step_;
+}
+
+template<class Real>
+M6SS::PsyncTail M6SS::PsyncKernel<Real>::tail() const {
+    double pStep[MAX_LANES], pNoReception[MAX_LANES], remaining[MAX_LANES];
+    for (int i = 0; i < C_; i++) {
+        pStep[i] = static_cast<double>(pStep_[i]);
+        pNoReception[i] = static_cast<double>(pNoReception_[i]);
+        remaining[i] = static_cast<double>(survival_[i]) * (1 - static_cast<double>(periodSum_[i]));
+    }
+
+    return calculateTail(C_, n_, step_, pStep, pNoReception, remaining);
+}
+
+template<class Real>
+void M6SS::PsyncKernel<Real>::refreshStepProbabilities() {
+    for (int i = 0; i < 2 * MAX_LANES; i++) {
+        rotated_[i] = pStep_[i % C_] * factor_[i % C_];
+    }
+}
+
+template<class Real>
+M6SS::PsyncBatchKernel<Real>::PsyncBatchKernel(const std::vector<std::vector<double> > &pStep,
+                                               const std::vector<std::vector<double> > &pNoReception, long n) {
+    if (pStep.size() != pNoReception.size() or pStep.empty() or pStep.size() > PsyncKernel<Real>::MAX_LANES) {
+        throw std::invalid_argument("pStep and pNoReception must have the same number of rows, in the range [1, 16].");
+    }
+
+    for (size_t i = 0; i < pStep.size(); i++) {
+        if (pStep[i].size() != pStep[0].size() or pNoReception[i].size() != pStep[0].size()) {
+            throw std::invalid_argument("The rows of pStep and pNoReception must have the same size.");
+        }
+    }
+
+    if (n <= 0) {
+        throw std::invalid_argument("n must be greater than 0.");
+    }
+
+    C_ = pStep.size();
+    n_ = n;
+    numSets_ = pStep[0].size();
+
+    constexpr size_t width = simd::Vec<Real>::WIDTH;
+    stride_ = (numSets_ + width - 1) / width * width;
+
+    pStep_.assign(C_ * stride_, 0);
+    pNoReception_.assign(C_ * stride_, 1);
+    factor_.assign(C_ * stride_, 1);
+    pStepSp_.assign(C_ * stride_, 0);
+    survival_.assign(C_ * stride_, 1);
+    periodSum_.assign(C_ * stride_, 0);
+    pSync_.assign(stride_, 0);
+
+    for (int i = 0; i < C_; i++) {
+        for (size_t j = 0; j < numSets_; j++) {
+            pStep_[i * stride_ + j] = pStep[i][j];
+            pNoReception_[i * stride_ + j] = pNoReception[i][j];
+        }
+    }
+
+    refreshStepProbabilities();
+}
+
+template<class Real>
+void M6SS::PsyncBatchKernel<Real>::next(double *pSync) {
+    using V = simd::Vec<Real>;
+
+    long t = step_ % n_; // the position of the step within the scan period (zero based)
+    if (t == 0) {
+        if (scaled_) { // a new scan period begins; Nchp = 0
+            std::fill(factor_.begin(), factor_.end(), 1);
+            scaled_ = false;
+            refreshStepProbabilities();
+        }
+    } else if (t % C_ == 0) { // Nchp increases by one
+        for (size_t l = 0; l < factor_.size(); l += V::WIDTH) {
+            (V::load(&factor_[l]) * V::load(&pNoReception_[l])).store(&factor_[l]);
+        }
+        scaled_ = true;
+        refreshStepProbabilities();
+    }
+
+    std::fill(pSync_.begin(), pSync_.end(), 0);
+    for (int y = 0; y < C_; y++) {
+        // the lane y uses the channel X(k, y) = W((y + k - 1) mod C + 1)
+        const Real *p = &pStepSp_[((y + step_) % C_) * stride_];
+        Real *survival = &survival_[y * stride_], *periodSum = &periodSum_[y * stride_];
+        for (size_t l = 0; l < stride_; l += V::WIDTH) {
+            V pStepSp = V::load(p + l);
+            (V::load(&pSync_[l]) + V::load(survival + l) * pStepSp).store(&pSync_[l]);
+            (V::load(periodSum + l) + pStepSp).store(periodSum + l);
+        }
+    }
+
+    if (t == n_ - 1) { // the scan period ends; multiply the survival of each lane by Qsp
+        const V one = V::broadcast(1), zero = V::broadcast(0);
+        for (size_t l = 0; l < survival_.size(); l += V::WIDTH) {
+            (V::load(&survival_[l]) * (one - V::load(&periodSum_[l]))).store(&survival_[l]);
+            zero.store(&periodSum_[l]);
+        }
+    }
+
+    for (size_t j = 0; j < numSets_; j++) {
+        pSync[j] = static_cast<double>(pSync_[j]) / C_;
+    }
+
+    step_++;
+}
+
+template<class Real>
+size_t M6SS::PsyncBatchKernel<Real>::steps() const {
+    return step_;
+}
+
+template<class Real>
+M6SS::PsyncTail M6SS::PsyncBatchKernel<Real>::tail(size_t set) const {
+    double pStep[PsyncKernel<Real>::MAX_LANES], pNoReception[PsyncKernel<Real>::MAX_LANES];
+    double remaining[PsyncKernel<Real>::MAX_LANES];
+    for (int i = 0; i < C_; i++) {
+        pStep[i] = pStep_[i * stride_ + set];
+        pNoReception[i] = pNoReception_[i * stride_ + set];
+        remaining[i] = static_cast<double>(survival_[i * stride_ + set]) *
+                       (1 - static_cast<double>(periodSum_[i * stride_ + set]));
+    }
+
+    return calculateTail(C_, n_, step_, pStep, pNoReception, remaining);
+}
+
+template<class Real>
+void M6SS::PsyncBatchKernel<Real>::compact(const std::vector<size_t> &keep) {
+    constexpr size_t width = simd::Vec<Real>::WIDTH;
+    const size_t stride = (keep.size() + width - 1) / width * width;
+
+    auto compactRows = [&](std::vector<Real> &rows, Real padding) {
+        std::vector<Real> compacted(C_ * stride, padding);
+        for (int i = 0; i < C_; i++) {
+            for (size_t j = 0; j < keep.size(); j++) {
+                compacted[i * stride + j] = rows[i * stride_ + keep[j]];
+            }
+        }
+        rows.swap(compacted);
+    };
+
+    compactRows(pStep_, 0);
+    compactRows(pNoReception_, 1);
+    compactRows(factor_, 1);
+    compactRows(pStepSp_, 0);
+    compactRows(survival_, 1);
+    compactRows(periodSum_, 0);
+    pSync_.assign(stride, 0);
+
+    numSets_ = keep.size();
+    stride_ = stride;
+}
+
+template<class Real>
+size_t M6SS::PsyncBatchKernel<Real>::size() const {
+    return numSets_;
+}
+
+template<class Real>
+void M6SS::PsyncBatchKernel<Real>::refreshStepProbabilities() {
+    for (size_t l = 0; l < pStepSp_.size(); l++) {
+        pStepSp_[l] = pStep_[l] * factor_[l];
+    }
+}
+
+template
+class M6SS::PsyncKernel<double>;
+
+template
+class M6SS::PsyncKernel<float>;
+
+template
+class M6SS::PsyncKernel<M6SS::Dual<5> >;
+
+template
+class M6SS::PsyncKernel<M6SS::Dual<9> >;
+
+template
+class M6SS::PsyncKernel<M6SS::Dual<17> >;
+
+template
+class M6SS::PsyncBatchKernel<double>;
+
+template
+class M6SS::PsyncBatchKernel<float>;
@@ -0,0 +1,168 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_PSYNCKERNEL_H
+#define M6SS_PSYNCKERNEL_H
+
+#include <vector>
+#include <cstddef>
+
+namespace M6SS {
+
+    /**
+     * The part of the distribution of the number of steps that has not been calculated yet by a kernel.
+     */
+    struct PsyncTail {
+        double mass; // the probability that the synchronization requires more than the calculated steps
+        double stepsBound; // an upper bound of the sum of k * Psync(k) over the steps k that have not been calculated
+    };
+
+    /**
+     * This class calculates Psync(k), k = 1, 2, ..., in Cases 1 and 2 of the model (i.e., when the scan period is
+     * shorter than a step or an integer multiple of it). Psync(k) is the average over the starting offsets
+     * y = 0, ..., C-1 of the conditional probabilities Psync(k|y), which are independent of each other. Thus, the kernel
+     * keeps a lane per y, advances all the lanes together in each step (using AVX-512 or AVX2 when the compiler targets
+     * them, otherwise a scalar loop) and reduces them horizontally. Each call to next() costs O(C), instead of the
+     * O(k * C) of the direct evaluation of the products in Psync(k|y).
+     * Note that Case 1 is equivalent to Case 2 with a single step per scan period. Real may also be a Dual, in which
+     * case the derivatives of Psync(k) are propagated through the lanes (see Model::Sensitivities).
+     */
+    template<class Real>
+    class PsyncKernel {
+    public:
+        /**
+         * The maximum number of lanes (i.e., the maximum number of channels).
+         */
+        static constexpr int MAX_LANES = 16;
+
+        /**
+         * Initializes a new instance of the PsyncKernel class.
+         * @param pStep for each i = 0, ..., C-1, the probability Pstep of an EB reception in a step where the minimal
+         * cell uses the channel W(i+1), i.e., 1/C * Peb * Psr(W(i+1)).
+         * @param pNoReception for each i = 0, ..., C-1, the probability that an EB is not received when the node scans
+         * the channel W(i+1) during a minimal cell that uses it, i.e., 1 - Peb * Psr(W(i+1)).
+         * @param n the number of steps in a scan period (1 in Case 1).
+         * @throw std::invalid_argument if the sizes of pStep and pNoReception differ or are not in the range
+         * [1, MAX_LANES], or, if n is not positive.
+         */
+        PsyncKernel(const std::vector<Real> &pStep, const std::vector<Real> &pNoReception, long n);
+
+        /**
+         * Advances all the lanes by one step.
+         * @return Psync(k) for the next step k (i.e., Psync(1) in the first call).
+         */
+        Real next();
+
+        /**
+         * Returns the number of steps calculated so far.
+         */
+        [[nodiscard]] size_t steps() const;
+
+        /**
+         * Returns the part of the distribution of the number of steps after the steps calculated so far.
+         */
+        [[nodiscard]] PsyncTail tail() const;
+
+    private:
+        void refreshStepProbabilities();
+
+        int C_;
+        long n_;
+        size_t step_ = 0;
+        int lanes_; // the number of lanes rounded up to a multiple of the vector width
+        bool scaled_ = false; // true if the factors of the current scan period are not all equal to 1
+
+        Real pStep_[MAX_LANES]{};
+        Real pNoReception_[MAX_LANES]{};
+        Real factor_[MAX_LANES]{}; // the factors (1 - Peb * Psr(W(i+1)))^Nchp of the current scan period
+        // Pstep_sp for the positions of W repeated twice, so that the lanes of a step are read contiguously
+        alignas(64) Real rotated_[2 * MAX_LANES]{};
+        alignas(64) Real survival_[MAX_LANES]{}; // the product of Qsp for the completed scan periods of each lane
+        alignas(64) Real periodSum_[MAX_LANES]{}; // the sum of Pstep_sp in the current scan period of each lane
+    };
+
+    /**
+     * This class is the counterpart of PsyncKernel for a batch of parameter sets that differ only in the probabilities
+     * Peb and Psr (see ParameterBatch). Here, the SIMD lanes correspond to the parameter sets, while the starting offsets
+     * y are iterated within each step. All the values of the kernel are stored in a structure-of-arrays layout, i.e.,
+     * each row (one for each position of W or each y) holds the values of all the parameter sets contiguously.
+     */
+    template<class Real>
+    class PsyncBatchKernel {
+    public:
+        /**
+         * Initializes a new instance of the PsyncBatchKernel class.
+         * @param pStep for each i = 0, ..., C-1, a row with the probability Pstep for the channel W(i+1) of each
+         * parameter set (see PsyncKernel).
+         * @param pNoReception for each i = 0, ..., C-1, a row with the probability 1 - Peb * Psr(W(i+1)) of each
+         * parameter set.
+         * @param n the number of steps in a scan period (1 in Case 1).
+         * @throw std::invalid_argument if the number of the rows of pStep and pNoReception differ or are not in the
+         * range [1, PsyncKernel<Real>::MAX_LANES], or, if the rows do not have the same size, or, if n is not positive.
+         */
+        PsyncBatchKernel(const std::vector<std::vector<double> > &pStep,
+                         const std::vector<std::vector<double> > &pNoReception, long n);
+
+        /**
+         * Advances all the parameter sets by one step.
+         * @param pSync an array where Psync(k) of each parameter set will be stored, for the next step k.
+         */
+        void next(double *pSync);
+
+        /**
+         * Returns the number of steps calculated so far.
+         */
+        [[nodiscard]] size_t steps() const;
+
+        /**
+         * Returns the part of the distribution of the number of steps of a parameter set after the steps calculated so
+         * far.
+         * @param set the index of the parameter set.
+         */
+        [[nodiscard]] PsyncTail tail(size_t set) const;
+
+        /**
+         * Removes from the kernel the parameter sets that are not needed anymore, so that the following steps cost in
+         * proportion to the remaining ones.
+         * @param keep the indices of the parameter sets to keep, in ascending order; the kept sets are renumbered in
+         * this order.
+         */
+        void compact(const std::vector<size_t> &keep);
+
+        /**
+         * Returns the number of parameter sets in the kernel.
+         */
+        [[nodiscard]] size_t size() const;
+
+    private:
+        void refreshStepProbabilities();
+
+        int C_;
+        long n_;
+        size_t numSets_;
+        size_t stride_; // the number of sets rounded up to a multiple of the vector width
+        size_t step_ = 0;
+        bool scaled_ = false;
+
+        // the following arrays consist of C rows of stride_ values
+        std::vector<Real> pStep_, pNoReception_, factor_, pStepSp_; // one row for each position of W
+        std::vector<Real> survival_, periodSum_; // one row for each y
+        std::vector<Real> pSync_; // a single row
+    };
+
+}
+
+#endif //M6SS_PSYNCKERNEL_H
@@ -0,0 +1,126 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "scanperiodgeometry.h"
+
+using std::chrono::nanoseconds, std::floor, std::ceil;
+using namespace std::chrono_literals;
+
+M6SS::ScanPeriodGeometry::ScanPeriodGeometry(nanoseconds Tscan, nanoseconds Tsf, nanoseconds Teb, int C, size_t i,
+                                             int y, const TimeInterval &I)
+        : Tsf_(Tsf), Teb_(Teb), C_(C), y_(y), I_(I) {
+    const double n = Tscan * 1.0 / Tsf;
+
+    // true if the scan period i starts within a step, i.e., not at its beginning
+    auto B = [n](size_t i) { return (i - 1) * n != floor((i - 1) * n); };
+
+    TimeInterval Rl(
+            i * Tscan % Tsf, // equivalent to (i * n - floor(i*n)) * Tsf,
+            Tsf
+    );
+    TimeInterval Ll(
+            0ns,
+            i * Tscan % Tsf // equivalent to (i*n - floor(i*n)) * Tsf
+    );
+    Z_ = B(i + 1) ? TimeInterval::intersection(I, Ll) : I;
+
+    k_f_ = B(i) ? ceil((i - 1) * n) : (i - 1) * n + 1;
+    k_l_ = ceil(i * n);
+    coversFirstStep_ = !B(i) or I.isSubsetOf(
+            TimeInterval( //Rf
+                    (i - 1) * Tscan % Tsf, // equivalent to ((i - 1) * n - floor((i - 1) * n)) * Tsf
+                    Tsf)
+    );
+
+    //Plsc -> Plast_step_covered
+    Plsc_ = B(i + 1) ? TimeInterval::intersection(I, Ll).length() * 1.0 / I.length() : 1;
+
+    TimeInterval NC = TimeInterval::intersection(I, Rl);
+    ncFraction_ = NC.length() * 1.0 / I.length();
+    if (B(i + 1)) {
+        NC_ = NC;
+    }
+}
+
+size_t M6SS::ScanPeriodGeometry::firstStep() const {
+    return k_f_;
+}
+
+size_t M6SS::ScanPeriodGeometry::lastStep() const {
+    return k_l_;
+}
+
+bool M6SS::ScanPeriodGeometry::coversFirstStep() const {
+    return coversFirstStep_;
+}
+
+int M6SS::ScanPeriodGeometry::channel(size_t k) const {
+    return (y_ + k - 1) % C_;
+}
+
+size_t M6SS::ScanPeriodGeometry::exponent(size_t k) const {
+    // M(k) is the number of the steps k_f, ..., k that cover the EB point
+    const size_t M = coversFirstStep_ ? k - k_f_ + 1 : k - k_f_;
+    return (M - 1) / C_;
+}
+
+std::chrono::duration<double, std::nano> M6SS::ScanPeriodGeometry::time(size_t k) const {
+    if (k == k_l_) {
+        return Z_.isEmpty() ? 0ns : (k - 1) * Tsf_ + Z_.getStart().value() + Z_.length() / 2.0 + Teb_;
+    }
+    return (k - 1) * Tsf_ + I_.getStart().value() + I_.length() / 2.0 + Teb_;
+}
+
+double M6SS::ScanPeriodGeometry::lastStepCoverage() const {
+    return Plsc_;
+}
+
+double M6SS::ScanPeriodGeometry::notCoveredFraction() const {
+    return ncFraction_;
+}
+
+const M6SS::TimeInterval &M6SS::ScanPeriodGeometry::coveredNext() const {
+    return Z_;
+}
+
+const M6SS::TimeInterval &M6SS::ScanPeriodGeometry::notCoveredNext() const {
+    return NC_;
+}
+
+std::chrono::duration<double> M6SS::ScanPeriodGeometry::discardedTimeBound(nanoseconds Tscan, nanoseconds Tsf,
+                                                                         nanoseconds Teb, std::vector<double> pStep,
+                                                                         double discardedProb,
+                                                                         std::chrono::duration<double>
+                                                                         discardedStartTime) {
+    if (discardedProb <= 0) {
+        return discardedStartTime;
+    }
+
+    const size_t m = std::min<size_t>(Tscan / Tsf, pStep.size());
+    std::sort(pStep.begin(), pStep.end());
+    double p = 0;
+    for (size_t w = 0; w < m; w++) {
+        p += pStep[w];
+    }
+    if (p <= 0) {
+        return std::chrono::duration<double>(std::numeric_limits<double>::infinity());
+    }
+
+    return discardedStartTime + discardedProb * (std::chrono::duration<double>(Tscan) / p + Teb);
+}
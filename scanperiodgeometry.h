@@ -0,0 +1,141 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_SCANPERIODGEOMETRY_H
+#define M6SS_SCANPERIODGEOMETRY_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+#include "timeinterval.h"
+
+namespace M6SS {
+
+    /**
+     * This class represents the geometry of a scan period in Case 3 of the model (i.e., when the scan period is greater
+     * than a step, but is not an integer multiple of it): the steps k_f, ..., k_l that the scan period spans, the
+     * channels and the exponents of (1 - Peb * Psr) that they use, the times of the EB receptions in them, and the
+     * intervals of the EB point for the next scan period of the lane. It depends only on Tscan, Tsf, Teb and the number
+     * of channels C, as well as on the index i of the scan period, the lane y and the interval I of the EB point, so
+     * the probabilities are applied by its users, i.e., Model::calculate and ModelSession.
+     */
+    class ScanPeriodGeometry {
+    public:
+        /**
+         * Calculates the geometry of a scan period.
+         * @param Tscan the scan period.
+         * @param Tsf the duration of a step (slotframe).
+         * @param Teb the duration of an EB.
+         * @param C the number of channels.
+         * @param i the index of the scan period, starting from 1.
+         * @param y the lane, i.e., the starting offset in W, in the range [0, C).
+         * @param I the (non-empty) interval of the EB point within a step.
+         */
+        ScanPeriodGeometry(std::chrono::nanoseconds Tscan, std::chrono::nanoseconds Tsf, std::chrono::nanoseconds Teb,
+                           int C, size_t i, int y, const TimeInterval &I);
+
+        /**
+         * Returns the first step k_f of the scan period.
+         */
+        [[nodiscard]] size_t firstStep() const;
+
+        /**
+         * Returns the last step k_l of the scan period, which is always greater than k_f.
+         */
+        [[nodiscard]] size_t lastStep() const;
+
+        /**
+         * Returns true if the EB point is covered in the first step of the scan period.
+         */
+        [[nodiscard]] bool coversFirstStep() const;
+
+        /**
+         * Returns the index in W of the channel of the minimal cell in a step k, i.e., W(index + 1) = X(k, y).
+         */
+        [[nodiscard]] int channel(size_t k) const;
+
+        /**
+         * Returns the exponent of (1 - Peb * Psr) in the probability of a step k, for k_f < k ≤ k_l, i.e., the number
+         * of the previous steps of the scan period that use the same channel and cover the EB point.
+         */
+        [[nodiscard]] size_t exponent(size_t k) const;
+
+        /**
+         * Returns the average time of a synchronization in a step k, including Teb, for k_f ≤ k ≤ k_l. In the last
+         * step, the EB point is in coveredNext(), so the time is zero if it is empty.
+         */
+        [[nodiscard]] std::chrono::duration<double, std::nano> time(size_t k) const;
+
+        /**
+         * Returns the probability Plsc that the EB point is covered in the last step.
+         */
+        [[nodiscard]] double lastStepCoverage() const;
+
+        /**
+         * Returns the fraction of I that is not covered by the next scan period, i.e., |I ∩ Rl| / |I|.
+         */
+        [[nodiscard]] double notCoveredFraction() const;
+
+        /**
+         * Returns the interval of the EB point in the next scan period, if the EB point is covered in the last step
+         * (Z); an empty interval means that there is no such scan period.
+         */
+        [[nodiscard]] const TimeInterval &coveredNext() const;
+
+        /**
+         * Returns the interval of the EB point in the next scan period, if the EB point is not covered in the last step;
+         * an empty interval means that there is no such scan period.
+         */
+        [[nodiscard]] const TimeInterval &notCoveredNext() const;
+
+        /**
+         * Returns an upper bound of the sum of the synchronization times (weighted by their probabilities) after the
+         * scan periods that are not examined (e.g., due to the tolerance or the memory cap), i.e., of the error of the
+         * average synchronization time due to them. The EB point is covered in at least m = min(floor(n), C)
+         * consecutive steps of any scan period, whose channels are distinct, so the probability of a synchronization in
+         * a scan period that is reached is at least the sum p of the m smallest values of Pstep. Hence, the number of
+         * the scan periods from a discarded one up to the synchronization is at most geometric with parameter p, and
+         * the synchronization time after a discarded scan period i is at most (i - 1) * Tscan + Tscan / p + Teb.
+         * @param Tscan the scan period.
+         * @param Tsf the duration of a step (slotframe).
+         * @param Teb the duration of an EB.
+         * @param pStep the probability Pstep for each channel of W.
+         * @param discardedProb the total probability of the discarded scan periods.
+         * @param discardedStartTime the sum of the start times (i - 1) * Tscan of the discarded scan periods, weighted
+         * by their probabilities.
+         * @return the bound, which is infinite if p is zero (unless discardedProb is zero).
+         */
+        static std::chrono::duration<double> discardedTimeBound(std::chrono::nanoseconds Tscan,
+                                                                std::chrono::nanoseconds Tsf,
+                                                                std::chrono::nanoseconds Teb,
+                                                                std::vector<double> pStep, double discardedProb,
+                                                                std::chrono::duration<double> discardedStartTime);
+
+    private:
+        std::chrono::nanoseconds Tsf_, Teb_;
+        int C_;
+        int y_;
+        TimeInterval I_;
+        size_t k_f_, k_l_;
+        bool coversFirstStep_;
+        double Plsc_;
+        double ncFraction_;
+        TimeInterval Z_, NC_;
+    };
+
+}
+
+#endif //M6SS_SCANPERIODGEOMETRY_H
@@ -0,0 +1,155 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include "threadpool.h"
+#include "modelcache.h"
+#include "scanperiodoptimizer.h"
+
+using std::chrono::duration;
+using std::chrono::nanoseconds;
+
+M6SS::ScanPeriodOptimizer::Result M6SS::ScanPeriodOptimizer::optimize(const SyncParameters &syncParams,
+                                                                      const Options &options, ModelCache &cache,
+                                                                      ThreadPool &pool) {
+    if (options.percentile < 0 or options.percentile >= 1) {
+        throw std::invalid_argument("percentile must be in the range [0, 1).");
+    }
+
+    if (options.maxN != 0 and options.maxN < 1) {
+        throw std::invalid_argument("maxN must be zero or not less than one.");
+    }
+
+    if (options.subdivisions < 1 or options.coarseSubdivisions < 1 or
+        options.subdivisions % options.coarseSubdivisions != 0) {
+        throw std::invalid_argument("coarseSubdivisions must be a positive divisor of subdivisions.");
+    }
+
+    const int C = syncParams.getCHS().size();
+    const nanoseconds Tsf = syncParams.getS() * SyncParameters::DEFAULT_SLOT_DURATION;
+
+    // the values of n are represented as integer multiples of 1 / subdivisions (ticks), so that they are exact
+    const long ticksPerUnit = options.subdivisions;
+    const long coarseTicks = options.subdivisions / options.coarseSubdivisions;
+    const long minTicks = ticksPerUnit;
+    const long maxTicks = std::max(minTicks, long(std::floor((options.maxN > 0 ? options.maxN : 2.0 * C) *
+                                                             ticksPerUnit)));
+
+    auto tScanOf = [&](long ticks) {
+        return std::chrono::round<nanoseconds>(Tsf * (ticks / double(ticksPerUnit)));
+    };
+
+    // the objective of the search and the average synchronization time, which breaks the ties
+    auto objectiveOf = [&](const Model::Results &results) {
+        duration<double> objective = options.percentile > 0 ? results.quantileTime(options.percentile)
+                                                            : results.avgSyncTime();
+        return std::make_pair(objective, results.avgSyncTime());
+    };
+
+    struct Evaluation {
+        std::pair<duration<double>, duration<double> > objective;
+        std::shared_ptr<const Model::Results> results;
+    };
+    std::map<long, Evaluation> evaluations; // ticks -> evaluation
+
+    auto evaluate = [&](std::vector<long> ticks) {
+        std::sort(ticks.begin(), ticks.end());
+        ticks.erase(std::unique(ticks.begin(), ticks.end()), ticks.end());
+        ticks.erase(std::remove_if(ticks.begin(), ticks.end(), [&](long t) { return evaluations.count(t) > 0; }),
+                    ticks.end());
+
+        std::vector<std::shared_ptr<const Model::Results> > results(ticks.size());
+        pool.parallelFor(ticks.size(), [&](size_t i) {
+            SyncParameters candidate(syncParams.getCHS(), syncParams.getS(), syncParams.getPeb(), syncParams.getPsr(),
+                                     tScanOf(ticks[i]), syncParams.getTSwitch(), syncParams.getTeb());
+            results[i] = cache.get(candidate);
+        });
+
+        for (size_t i = 0; i < ticks.size(); i++) {
+            evaluations[ticks[i]] = Evaluation{objectiveOf(*results[i]), results[i]};
+        }
+    };
+
+    auto bestIn = [&evaluations](long first, long last) { // the best evaluation in [first, last]
+        auto best = evaluations.lower_bound(first);
+        for (auto it = best; it != evaluations.end() and it->first <= last; ++it) {
+            if (it->second.objective < best->second.objective) {
+                best = it;
+            }
+        }
+        return best;
+    };
+
+    // the coarse grid, which includes all the integer values of n (i.e., Case 2)
+    std::vector<long> grid;
+    for (long ticks = minTicks; ticks <= maxTicks; ticks += coarseTicks) {
+        grid.push_back(ticks);
+    }
+    for (long ticks = minTicks; ticks <= maxTicks; ticks += ticksPerUnit) {
+        grid.push_back(ticks);
+    }
+    evaluate(grid);
+
+    // Refine the bracket around the best value, evaluating several equidistant values in each step (as many as the
+    // threads that can evaluate them in parallel, but at least four).
+    const long numPoints = std::max(4, pool.size() + 1);
+    long best = bestIn(minTicks, maxTicks)->first;
+    long first = std::max(minTicks, best - coarseTicks);
+    long last = std::min(maxTicks, best + coarseTicks);
+    while (last - first > 2) {
+        std::vector<long> points;
+        for (long j = 1; j <= numPoints; j++) {
+            points.push_back(first + (last - first) * j / (numPoints + 1));
+        }
+        evaluate(points);
+
+        auto it = bestIn(first, last);
+        best = it->first;
+        long newFirst = it == evaluations.begin() ? first : std::max(first, std::prev(it)->first);
+        long newLast = std::next(it) == evaluations.end() ? last : std::min(last, std::next(it)->first);
+        if (newFirst == first and newLast == last) {
+            break;
+        }
+        first = newFirst;
+        last = newLast;
+    }
+
+    // the values inside the final bracket
+    std::vector<long> remaining;
+    for (long ticks = first; ticks <= last; ticks++) {
+        remaining.push_back(ticks);
+    }
+    evaluate(remaining);
+
+    auto optimal = bestIn(minTicks, maxTicks);
+    Result result;
+    result.n = optimal->first / double(ticksPerUnit);
+    result.tScan = tScanOf(optimal->first);
+    result.objective = optimal->second.objective.first;
+    result.results = optimal->second.results;
+    result.numEvaluations = evaluations.size();
+    return result;
+}
+
+M6SS::ScanPeriodOptimizer::Result M6SS::ScanPeriodOptimizer::optimize(const SyncParameters &syncParams,
+                                                                      const Options &options) {
+    ModelCache cache(1024);
+    return optimize(syncParams, options, cache, ThreadPool::shared());
+}
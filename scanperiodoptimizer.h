@@ -0,0 +1,102 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_SCANPERIODOPTIMIZER_H
+#define M6SS_SCANPERIODOPTIMIZER_H
+
+#include <chrono>
+#include <memory>
+#include "syncparameters.h"
+#include "model.h"
+
+namespace M6SS {
+
+    class ThreadPool; // forward declaration
+    class ModelCache; // forward declaration
+
+    /**
+     * This class finds, through the model, the scan period (Tscan) that minimizes the average synchronization time or
+     * a percentile of the synchronization time, for the rest of the synchronization parameters. The ratio
+     * n = Tscan / Tsf is searched in [1, maxN], since all the scan periods shorter than a slotframe are equivalent to
+     * n = 1 (see Case 1 of the model). The search first evaluates a coarse grid of n, which includes all the integer
+     * values (Case 2), and then brackets the best value and refines it, evaluating several fractional values (Case 3)
+     * in parallel in each step. The evaluations go through a ModelCache, so repeated searches (e.g., for percentiles
+     * of the same parameters) reuse the results.
+     */
+    class ScanPeriodOptimizer {
+    public:
+        struct Options; // forward declaration
+        struct Result; // forward declaration
+
+        /**
+         * Finds the optimal scan period.
+         * @param syncParams the synchronization parameters; their scan period is ignored.
+         * @param options the options of the search (see below).
+         * @param cache the cache through which the model is evaluated; its options control the accuracy.
+         * @param pool the thread pool that makes the evaluations.
+         * @return the optimal scan period and its results.
+         * @throw std::invalid_argument if the options are not valid.
+         */
+        static Result optimize(const SyncParameters &syncParams, const Options &options, ModelCache &cache,
+                               ThreadPool &pool);
+
+        /**
+         * The same as the function above, but the evaluations are made by the shared thread pool through a cache
+         * that is used only for this search.
+         */
+        static Result optimize(const SyncParameters &syncParams, const Options &options);
+
+        /**
+         * The options of a search.
+         */
+        struct Options {
+            /**
+             * If zero, the average synchronization time is minimized. Otherwise, the given percentile of the
+             * synchronization time (e.g., 0.95) is minimized, and the average synchronization time breaks the ties.
+             */
+            double percentile = 0;
+
+            /**
+             * The maximum value of n. If zero, it is 2C, where C is the number of channels.
+             */
+            double maxN = 0;
+
+            /**
+             * The resolution of n is 1 / subdivisions.
+             */
+            int subdivisions = 64;
+
+            /**
+             * The step of the coarse grid is 1 / coarseSubdivisions, which must divide subdivisions.
+             */
+            int coarseSubdivisions = 4;
+        };
+
+        /**
+         * The result of a search.
+         */
+        struct Result {
+            double n; // the optimal value of Tscan / Tsf
+            std::chrono::nanoseconds tScan; // the optimal scan period
+            std::chrono::duration<double> objective; // the minimized average or percentile
+            std::shared_ptr<const Model::Results> results; // the results of the model for the optimal scan period
+            size_t numEvaluations; // the number of the values of n that were evaluated (including the cache hits)
+        };
+    };
+
+}
+
+#endif //M6SS_SCANPERIODOPTIMIZER_H
@@ -0,0 +1,166 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_SIMD_H
+#define M6SS_SIMD_H
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+
+#include <immintrin.h>
+
+#endif
+
+namespace M6SS::simd {
+
+    /**
+     * A minimal wrapper around a SIMD register of WIDTH values of type Real. The generic version holds a single value
+     * and is used as the scalar fallback (as well as for any Real type that has no vector counterpart). Specializations
+     * for float and double are provided when the compiler targets AVX-512 or AVX2 (e.g., with -march=native).
+     * All the loads and stores are unaligned.
+     */
+    template<class Real>
+    struct Vec {
+        static constexpr int WIDTH = 1;
+        Real v;
+
+        static Vec load(const Real *p) { return {*p}; }
+
+        static Vec broadcast(Real x) { return {x}; }
+
+        void store(Real *p) const { *p = v; }
+
+        [[nodiscard]] Real reduceAdd() const { return v; }
+
+        friend Vec operator+(const Vec &a, const Vec &b) { return {a.v + b.v}; }
+
+        friend Vec operator-(const Vec &a, const Vec &b) { return {a.v - b.v}; }
+
+        friend Vec operator*(const Vec &a, const Vec &b) { return {a.v * b.v}; }
+    };
+
+#if defined(__AVX512F__)
+
+    template<>
+    struct Vec<double> {
+        static constexpr int WIDTH = 8;
+        __m512d v;
+
+        static Vec load(const double *p) { return {_mm512_loadu_pd(p)}; }
+
+        static Vec broadcast(double x) { return {_mm512_set1_pd(x)}; }
+
+        void store(double *p) const { _mm512_storeu_pd(p, v); }
+
+        [[nodiscard]] double reduceAdd() const {
+            // the intrinsics that reduce or cast a __m512d start from _mm256_undefined_pd(), for which GCC warns with
+            // -Wuninitialized; both halves are thus extracted through a mask with a defined (zero) source
+            __m256d zero = _mm256_setzero_pd();
+            __m256d half = _mm256_add_pd(_mm512_mask_extractf64x4_pd(zero, 0xFF, v, 0),
+                                         _mm512_mask_extractf64x4_pd(zero, 0xFF, v, 1));
+            __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(half), _mm256_extractf128_pd(half, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+        }
+
+        friend Vec operator+(const Vec &a, const Vec &b) { return {_mm512_add_pd(a.v, b.v)}; }
+
+        friend Vec operator-(const Vec &a, const Vec &b) { return {_mm512_sub_pd(a.v, b.v)}; }
+
+        friend Vec operator*(const Vec &a, const Vec &b) { return {_mm512_mul_pd(a.v, b.v)}; }
+    };
+
+    template<>
+    struct Vec<float> {
+        static constexpr int WIDTH = 16;
+        __m512 v;
+
+        static Vec load(const float *p) { return {_mm512_loadu_ps(p)}; }
+
+        static Vec broadcast(float x) { return {_mm512_set1_ps(x)}; }
+
+        void store(float *p) const { _mm512_storeu_ps(p, v); }
+
+        [[nodiscard]] float reduceAdd() const {
+            // as above; the halves are extracted as doubles, since _mm512_extractf32x8_ps requires AVX512DQ
+            __m256d zero = _mm256_setzero_pd();
+            __m512d bits = _mm512_castps_pd(v);
+            __m256 half = _mm256_add_ps(_mm256_castpd_ps(_mm512_mask_extractf64x4_pd(zero, 0xFF, bits, 0)),
+                                        _mm256_castpd_ps(_mm512_mask_extractf64x4_pd(zero, 0xFF, bits, 1)));
+            __m128 sum = _mm_add_ps(_mm256_castps256_ps128(half), _mm256_extractf128_ps(half, 1));
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+        }
+
+        friend Vec operator+(const Vec &a, const Vec &b) { return {_mm512_add_ps(a.v, b.v)}; }
+
+        friend Vec operator-(const Vec &a, const Vec &b) { return {_mm512_sub_ps(a.v, b.v)}; }
+
+        friend Vec operator*(const Vec &a, const Vec &b) { return {_mm512_mul_ps(a.v, b.v)}; }
+    };
+
+#elif defined(__AVX2__)
+
+    template<>
+    struct Vec<double> {
+        static constexpr int WIDTH = 4;
+        __m256d v;
+
+        static Vec load(const double *p) { return {_mm256_loadu_pd(p)}; }
+
+        static Vec broadcast(double x) { return {_mm256_set1_pd(x)}; }
+
+        void store(double *p) const { _mm256_storeu_pd(p, v); }
+
+        [[nodiscard]] double reduceAdd() const {
+            __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+        }
+
+        friend Vec operator+(const Vec &a, const Vec &b) { return {_mm256_add_pd(a.v, b.v)}; }
+
+        friend Vec operator-(const Vec &a, const Vec &b) { return {_mm256_sub_pd(a.v, b.v)}; }
+
+        friend Vec operator*(const Vec &a, const Vec &b) { return {_mm256_mul_pd(a.v, b.v)}; }
+    };
+
+    template<>
+    struct Vec<float> {
+        static constexpr int WIDTH = 8;
+        __m256 v;
+
+        static Vec load(const float *p) { return {_mm256_loadu_ps(p)}; }
+
+        static Vec broadcast(float x) { return {_mm256_set1_ps(x)}; }
+
+        void store(float *p) const { _mm256_storeu_ps(p, v); }
+
+        [[nodiscard]] float reduceAdd() const {
+            __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+        }
+
+        friend Vec operator+(const Vec &a, const Vec &b) { return {_mm256_add_ps(a.v, b.v)}; }
+
+        friend Vec operator-(const Vec &a, const Vec &b) { return {_mm256_sub_ps(a.v, b.v)}; }
+
+        friend Vec operator*(const Vec &a, const Vec &b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    };
+
+#endif
+
+}
+
+#endif //M6SS_SIMD_H
@@ -17,6 +17,8 @@
 #include <random>
 #include <algorithm>
 #include <set>
+#include <cmath>
+#include <limits>
 #include "simulator.h"
 
 using std::vector, std::chrono::nanoseconds, std::set, std::random_device, std::mt19937, std::uniform_int_distribution,
@@ -25,6 +27,36 @@ using namespace std::chrono_literals;
 
 M6SS::Simulator::Results &
 M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &results) {
+    return run(syncParams, numRuns, results, CancellationToken());
+}
+
+M6SS::Simulator::Results &
+M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &results,
+                     const CancellationToken &cancellation) {
+    thread_local random_device randomDevice;
+    thread_local mt19937 randomGenerator1(randomDevice()), randomGenerator2(randomDevice()), randomGenerator3(
+            randomDevice());
+
+    return run(syncParams, numRuns, results, cancellation, randomGenerator1, randomGenerator2, randomGenerator3);
+}
+
+M6SS::Simulator::Results &
+M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &results,
+                     const CancellationToken &cancellation, uint64_t seed) {
+    // each generator is seeded with its own sequence, derived from the seed and its number
+    auto generator = [seed](uint32_t number) {
+        std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), number};
+        return mt19937(sequence);
+    };
+    mt19937 randomGenerator1 = generator(1), randomGenerator2 = generator(2), randomGenerator3 = generator(3);
+
+    return run(syncParams, numRuns, results, cancellation, randomGenerator1, randomGenerator2, randomGenerator3);
+}
+
+M6SS::Simulator::Results &
+M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &results,
+                     const CancellationToken &cancellation, mt19937 &randomGenerator1, mt19937 &randomGenerator2,
+                     mt19937 &randomGenerator3) {
 
     if (numRuns <= 0) {
         throw std::invalid_argument("The parameter numRuns must be greater than 0");
@@ -35,9 +67,6 @@ M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &re
     const int C = chs.size(); // the number of available channels in the network
     nanoseconds slotframeDuration = SyncParameters::DEFAULT_SLOT_DURATION * syncParams.getS();
     nanoseconds channelRotationCycle = C * slotframeDuration;
-    thread_local random_device randomDevice;
-    thread_local mt19937 randomGenerator1(randomDevice()), randomGenerator2(randomDevice()), randomGenerator3(
-            randomDevice());
 
     uniform_int_distribution<int> uniformIntDistributionRC(0, availableChannels.size() - 1);
     uniform_real_distribution<long double> uniformRealDistribution0_1(0, 1);
@@ -46,24 +75,28 @@ M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &re
     // this map stores the number of synchronization attempts that finish in a specific (time) step
     std::map<long, long> counter;
 
-    auto randomChannel = [&uniformIntDistributionRC, &availableChannels]() {
+    auto randomChannel = [&uniformIntDistributionRC, &availableChannels, &randomGenerator1]() {
         return availableChannels[uniformIntDistributionRC(randomGenerator1)];
     };
 
-    auto random = [&uniformRealDistribution0_1]() {
+    auto random = [&uniformRealDistribution0_1, &randomGenerator2]() {
         // Returns a random floating point number in the range [0.0, 1.0)
         return uniformRealDistribution0_1(randomGenerator2);
     };
 
-    auto randomScanStartTime = [&startTimeDistribution]() {
+    auto randomScanStartTime = [&startTimeDistribution, &randomGenerator3]() {
         // Returns a random time within the first channel rotation period
         return nanoseconds(startTimeDistribution(randomGenerator3));
     };
 
     std::chrono::duration<double> avg_st = 0s;
+    double avg_st_squared = 0; // the average of the squares of the synchronization times, in seconds squared
 
 
     for (long run = 0; run < numRuns; run++) {
+        if (run % CANCELLATION_POLL_INTERVAL == 0) {
+            cancellation.throwIfCancelled();
+        }
 
         nanoseconds scanStartTime = randomScanStartTime();
         long long scanStartASN =
@@ -123,7 +156,9 @@ M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &re
 
                         ) {
 
-                    avg_st += (txTime - scanStartTime + syncParams.getTeb()) / (double) numRuns;
+                    std::chrono::duration<double> st = txTime - scanStartTime + syncParams.getTeb();
+                    avg_st += st / (double) numRuns;
+                    avg_st_squared += st.count() * st.count() / numRuns;
                     // calculate the current (time) step; that is, the step where the EB was found.
                     long long current_step = ceil((txTime - scanStartTime) * 1.0 / slotframeDuration);
 
@@ -144,17 +179,38 @@ M6SS::Simulator::run(const SyncParameters &syncParams, long numRuns, Results &re
     }
 
     // Set the avgSyncTime_ in the results
+    results.numRuns_ = numRuns;
     results.avgSyncTime_ = avg_st;
+    results.syncTimeStdDev_ = std::chrono::duration<double>(
+            std::sqrt(std::max(0.0, avg_st_squared - avg_st.count() * avg_st.count())));
+    results.Tsf_ = slotframeDuration;
+    results.Teb_ = syncParams.getTeb();
+
+    // Calculate the moments of the steps
+    for (double &moment: results.moments_) {
+        moment = 0;
+    }
+    for (const auto &entry: counter) {
+        double term = static_cast<double>(entry.second) / numRuns;
+        for (double &moment: results.moments_) {
+            term *= entry.first;
+            moment += term;
+        }
+    }
 
-    // Create CDF
-    results.cdf_.assign(counter.rbegin()->first + 1, 0);
+    // Create CDF; it is stored only at the steps where it changes, which are at most as many as the runs
+    results.cdfSize_ = counter.rbegin()->first + 1;
+    results.cdfSteps_.clear();
+    results.cdfValues_.clear();
 
     long long sumCounters = 0;
-    for (size_t i = 1; i < results.cdf_.size(); i++) {
-        if (counter.find(i) != counter.end()) {
-            sumCounters += counter[i];
+    for (const auto &entry: counter) {
+        if (entry.first < 1) {
+            continue;
         }
-        results.cdf_[i] = static_cast<double>(sumCounters) / numRuns;
+        sumCounters += entry.second;
+        results.cdfSteps_.push_back(entry.first);
+        results.cdfValues_.push_back(static_cast<double>(sumCounters) / numRuns);
     }
 
     return results;
@@ -169,9 +225,104 @@ double M6SS::Simulator::Results::cdf(size_t steps) {
         throw std::invalid_argument("steps must be greater than zero.");
     }
 
-    if (steps >= cdf_.size()) {
+    if (steps >= cdfSize_) {
         return 1.0;
     }
 
-    return cdf_[steps];
-}
\ No newline at end of file
+    // the value at the last step, up to the given one, where the cdf changes
+    auto it = std::upper_bound(cdfSteps_.begin(), cdfSteps_.end(), long(steps));
+    return it == cdfSteps_.begin() ? 0 : cdfValues_[it - cdfSteps_.begin() - 1];
+}
+
+size_t M6SS::Simulator::Results::quantile(double p) const {
+    if (not(p >= 0 and p <= 1)) {
+        throw std::invalid_argument("p must be in the range [0, 1].");
+    }
+
+    if (p == 0) {
+        return 1;
+    }
+
+    // cdf(k) is one after the last step of the samples
+    auto it = std::lower_bound(cdfValues_.begin(), cdfValues_.end(), p);
+    return it == cdfValues_.end() ? cdfSize_ : cdfSteps_[it - cdfValues_.begin()];
+}
+
+std::chrono::duration<double> M6SS::Simulator::Results::quantileTime(double p) const {
+    return quantile(p) * Tsf_ + Teb_;
+}
+
+double M6SS::Simulator::Results::moment(int order) const {
+    if (order < 1 or order > MAX_MOMENT_ORDER) {
+        throw std::invalid_argument("order must be in the range [1, MAX_MOMENT_ORDER].");
+    }
+
+    return moments_[order - 1];
+}
+
+double M6SS::Simulator::Results::variance() const {
+    return std::max(0.0, moments_[1] - moments_[0] * moments_[0]);
+}
+
+std::chrono::duration<double> M6SS::Simulator::Results::syncTimeStdDev() const {
+    return syncTimeStdDev_;
+}
+
+long M6SS::Simulator::Results::numRuns() const {
+    return numRuns_;
+}
+
+M6SS::Simulator::Results &M6SS::Simulator::Results::merge(const Results &other) {
+    if (other.numRuns_ == 0) {
+        return *this;
+    }
+
+    if (numRuns_ == 0) {
+        return *this = other;
+    }
+
+    // the weights of the two sets of samples
+    const double w1 = static_cast<double>(numRuns_) / (numRuns_ + other.numRuns_);
+    const double w2 = static_cast<double>(other.numRuns_) / (numRuns_ + other.numRuns_);
+
+    // the average of the squares of the synchronization times, in seconds squared
+    const double avgSquared = w1 * (syncTimeStdDev_.count() * syncTimeStdDev_.count() +
+                                    avgSyncTime_.count() * avgSyncTime_.count()) +
+                              w2 * (other.syncTimeStdDev_.count() * other.syncTimeStdDev_.count() +
+                                    other.avgSyncTime_.count() * other.avgSyncTime_.count());
+
+    avgSyncTime_ = w1 * avgSyncTime_ + w2 * other.avgSyncTime_;
+    syncTimeStdDev_ = std::chrono::duration<double>(
+            std::sqrt(std::max(0.0, avgSquared - avgSyncTime_.count() * avgSyncTime_.count())));
+
+    for (int r = 0; r < MAX_MOMENT_ORDER; r++) {
+        moments_[r] = w1 * moments_[r] + w2 * other.moments_[r];
+    }
+
+    // The merged cdf changes at the union of the steps where the two cdfs change, and at each of these steps it is the
+    // weighted average of the two cdfs.
+    vector<long> steps;
+    vector<double> values;
+    steps.reserve(cdfSteps_.size() + other.cdfSteps_.size());
+    values.reserve(cdfSteps_.size() + other.cdfSteps_.size());
+    size_t i = 0, j = 0;
+    double value1 = 0, value2 = 0;
+    while (i < cdfSteps_.size() or j < other.cdfSteps_.size()) {
+        long step = std::min(i < cdfSteps_.size() ? cdfSteps_[i] : std::numeric_limits<long>::max(),
+                             j < other.cdfSteps_.size() ? other.cdfSteps_[j] : std::numeric_limits<long>::max());
+        if (i < cdfSteps_.size() and cdfSteps_[i] == step) {
+            value1 = cdfValues_[i++];
+        }
+        if (j < other.cdfSteps_.size() and other.cdfSteps_[j] == step) {
+            value2 = other.cdfValues_[j++];
+        }
+        steps.push_back(step);
+        values.push_back(value1 == 1 and value2 == 1 ? 1 : w1 * value1 + w2 * value2); // exactly one at the end
+    }
+
+    cdfSteps_.swap(steps);
+    cdfValues_.swap(values);
+    cdfSize_ = std::max(cdfSize_, other.cdfSize_);
+    numRuns_ += other.numRuns_;
+    return *this;
+}
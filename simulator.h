@@ -20,7 +20,10 @@
 #include <vector>
 #include <map>
 #include <chrono>
+#include <random>
+#include <cstdint>
 #include "syncparameters.h"
+#include "cancellationtoken.h"
 
 namespace M6SS {
 
@@ -43,6 +46,38 @@ namespace M6SS {
          */
         static Results& run(const SyncParameters &syncParams, long numRuns, Results& results);
 
+        /**
+         * The same as the function above, but the simulation polls the given token every CANCELLATION_POLL_INTERVAL
+         * runs, and stops once it is cancelled.
+         * @param syncParams the synchronization parameters.
+         * @param numRuns the number of times to repeat the synchronization procedure; the number of samples to collect.
+         * @param results an object of type 'Results' (see below) where the results will be stored.
+         * @param cancellation the token that stops the simulation.
+         * @return a reference to the Results object
+         * @throw std::invalid_argument if numRuns is not greater than zero.
+         * @throw OperationCancelled if the token is cancelled during the simulation; results are left unchanged.
+         */
+        static Results& run(const SyncParameters &syncParams, long numRuns, Results& results,
+                            const CancellationToken &cancellation);
+
+        /**
+         * The same as the function above, but the random numbers of the simulation are drawn from generators that are
+         * seeded with the given seed, instead of from random devices, so that the same seed always gives the same
+         * results (e.g., for the repetition of a case of the validation of the model).
+         * @param syncParams the synchronization parameters.
+         * @param numRuns the number of times to repeat the synchronization procedure; the number of samples to collect.
+         * @param results an object of type 'Results' (see below) where the results will be stored.
+         * @param cancellation the token that stops the simulation.
+         * @param seed the seed of the random numbers.
+         * @return a reference to the Results object
+         * @throw std::invalid_argument if numRuns is not greater than zero.
+         * @throw OperationCancelled if the token is cancelled during the simulation; results are left unchanged.
+         */
+        static Results& run(const SyncParameters &syncParams, long numRuns, Results& results,
+                            const CancellationToken &cancellation, uint64_t seed);
+
+        static constexpr long CANCELLATION_POLL_INTERVAL = 1024;
+
         class Results {
             friend class Simulator;
         public:
@@ -63,10 +98,73 @@ namespace M6SS {
              */
              double cdf(size_t steps);
 
+            /**
+             * Returns the p-quantile of the number of steps X for the synchronization, i.e., the minimum number of
+             * steps k for which cdf(k) ≥ p.
+             * @param p the probability, in the range [0, 1].
+             * @return the minimum k ≥ 1 for which cdf(k) ≥ p.
+             * @throw std::invalid_argument if p is not in the range [0, 1].
+             */
+            size_t quantile(double p) const;
+
+            /**
+             * Returns an upper bound of the p-quantile of the synchronization time, i.e., quantile(p) * Tsf + Teb.
+             * @param p the probability, in the range [0, 1].
+             * @throw std::invalid_argument if p is not in the range [0, 1].
+             */
+            std::chrono::duration<double> quantileTime(double p) const;
+
+            /**
+             * Returns the raw moment E[X^order] of the number of steps X for the synchronization, over the samples.
+             * @param order the order of the moment, in the range [1, MAX_MOMENT_ORDER].
+             * @throw std::invalid_argument if order is not in the range [1, MAX_MOMENT_ORDER].
+             */
+            double moment(int order) const;
+
+            /**
+             * Returns the variance of the number of steps X for the synchronization, over the samples.
+             */
+            double variance() const;
+
+            /**
+             * Returns the standard deviation of the synchronization times of the samples.
+             */
+            std::chrono::duration<double> syncTimeStdDev() const;
+
+            /**
+             * Returns the number of the samples of the results.
+             */
+            long numRuns() const;
+
+            /**
+             * Merges the results of another simulation of the same synchronization parameters (e.g., of another chunk
+             * of the samples) into these results, so that they are the same (up to rounding) as if all the samples had
+             * been collected in a single run.
+             * @param other the results to merge.
+             * @return a reference to these results.
+             */
+            Results &merge(const Results &other);
+
+            static constexpr int MAX_MOMENT_ORDER = 4;
+
         private:
+            long numRuns_ = 0;
             std::chrono::duration<double> avgSyncTime_;
-            std::vector<double> cdf_;
+            size_t cdfSize_; // the cdf is one after cdfSize_ - 1 steps
+            std::vector<long> cdfSteps_; // the steps where the cdf changes, in increasing order
+            std::vector<double> cdfValues_; // the cdf at each of these steps
+            std::chrono::duration<double> syncTimeStdDev_;
+            std::chrono::nanoseconds Tsf_;
+            std::chrono::nanoseconds Teb_;
+            double moments_[MAX_MOMENT_ORDER]; // E[X^r] for r = 1, ..., MAX_MOMENT_ORDER
         };
+
+    private:
+        /* The simulation (see run), with the generators of the scanned channels, of the receptions and of the start
+         * times of the scans. */
+        static Results& run(const SyncParameters &syncParams, long numRuns, Results& results,
+                            const CancellationToken &cancellation, std::mt19937 &channelGenerator,
+                            std::mt19937 &receptionGenerator, std::mt19937 &startTimeGenerator);
     };
 
 }
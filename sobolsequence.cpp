@@ -0,0 +1,112 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <random>
+#include "sobolsequence.h"
+
+namespace {
+    /* the primitive polynomials and the initial direction numbers of the coordinates 2, ..., MAX_DIMENSIONS (the first
+     * coordinate is the van der Corput sequence), from the table new-joe-kuo-6.21201 of Joe and Kuo */
+    struct Polynomial {
+        int degree;
+        std::uint32_t coefficients; // the coefficients a of the inner terms
+        std::uint32_t initial[5]; // the initial direction numbers m_1, ..., m_degree
+    };
+
+    constexpr Polynomial POLYNOMIALS[] = {
+            {1, 0, {1}},
+            {2, 1, {1, 3}},
+            {3, 1, {1, 3, 1}},
+            {3, 2, {1, 1, 1}},
+            {4, 1, {1, 1, 3, 3}},
+            {4, 4, {1, 3, 5, 13}},
+            {5, 2, {1, 1, 5, 5, 17}},
+            {5, 4, {1, 1, 5, 5, 5}},
+            {5, 7, {1, 1, 7, 11, 19}}
+    };
+}
+
+M6SS::SobolSequence::SobolSequence(int dimensions, std::uint64_t seed) : dimensions_(dimensions) {
+    if (dimensions < 1 or dimensions > MAX_DIMENSIONS) {
+        throw std::invalid_argument("dimensions must be in the range [1, MAX_DIMENSIONS].");
+    }
+
+    std::seed_seq sequence{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)};
+    std::mt19937 generator(sequence);
+
+    directions_.resize(dimensions * NUM_BITS);
+    shifts_.resize(dimensions);
+    for (int d = 0; d < dimensions; d++) {
+        // the direction numbers v_k = m_k / 2^k, as fractions of 2^NUM_BITS
+        std::uint32_t v[NUM_BITS];
+        if (d == 0) {
+            for (int k = 0; k < NUM_BITS; k++) {
+                v[k] = 1u << (NUM_BITS - 1 - k);
+            }
+        } else {
+            const Polynomial &p = POLYNOMIALS[d - 1];
+            for (int k = 0; k < p.degree; k++) {
+                v[k] = p.initial[k] << (NUM_BITS - 1 - k);
+            }
+            for (int k = p.degree; k < NUM_BITS; k++) {
+                v[k] = v[k - p.degree] ^ (v[k - p.degree] >> p.degree);
+                for (int i = 1; i < p.degree; i++) {
+                    if ((p.coefficients >> (p.degree - 1 - i)) & 1) {
+                        v[k] ^= v[k - i];
+                    }
+                }
+            }
+        }
+
+        // The scrambling matrix maps each binary digit of a coordinate to itself plus a random combination of the
+        // less significant digits. Its column for bit b is (1 << b) plus random bits below b, and since it is linear,
+        // it is applied once to each direction number.
+        std::uint32_t columns[NUM_BITS];
+        for (int b = 0; b < NUM_BITS; b++) {
+            std::uint32_t below = b == 0 ? 0 : static_cast<std::uint32_t>(generator()) & ((1u << b) - 1);
+            columns[b] = (1u << b) | below;
+        }
+        for (int k = 0; k < NUM_BITS; k++) {
+            std::uint32_t scrambled = 0;
+            for (int b = 0; b < NUM_BITS; b++) {
+                if ((v[k] >> b) & 1) {
+                    scrambled ^= columns[b];
+                }
+            }
+            directions_[d * NUM_BITS + k] = scrambled;
+        }
+        shifts_[d] = static_cast<std::uint32_t>(generator());
+    }
+}
+
+std::vector<double> M6SS::SobolSequence::point(std::uint32_t index) const {
+    std::vector<double> u(dimensions_);
+    for (int d = 0; d < dimensions_; d++) {
+        std::uint32_t x = shifts_[d];
+        for (int k = 0; k < NUM_BITS; k++) {
+            if ((index >> k) & 1) {
+                x ^= directions_[d * NUM_BITS + k];
+            }
+        }
+        u[d] = x * 0x1p-32;
+    }
+    return u;
+}
+
+int M6SS::SobolSequence::dimensions() const {
+    return dimensions_;
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_SOBOLSEQUENCE_H
+#define M6SS_SOBOLSEQUENCE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace M6SS {
+
+    /**
+     * This class represents a scrambled Sobol sequence, i.e., a low-discrepancy sequence of points in the unit cube
+     * [0, 1)^d, whose first N points cover the cube much more evenly than N independent uniform points (e.g., the
+     * first 2^m points have exactly one point in each interval [k / 2^m, (k + 1) / 2^m) of each coordinate).
+     *
+     * The points are those of the Sobol sequence with the direction numbers of Joe and Kuo, scrambled through a random
+     * linear (lower triangular) transformation of the binary digits of each coordinate and a random digital shift
+     * (Matousek's scrambling). The scrambling keeps the uniformity of the sequence but makes each point uniformly
+     * distributed in the cube, so that the estimates over different seeds are unbiased and independent. Any point can
+     * be computed directly from its index.
+     */
+    class SobolSequence {
+    public:
+        /**
+         * Initializes a scrambled Sobol sequence.
+         * @param dimensions the number of the coordinates of each point, in the range [1, MAX_DIMENSIONS].
+         * @param seed the seed of the scrambling.
+         * @throw std::invalid_argument if dimensions is out of range.
+         */
+        SobolSequence(int dimensions, std::uint64_t seed);
+
+        /**
+         * Returns a point of the sequence.
+         * @param index the index of the point.
+         * @return the coordinates of the point, each in [0, 1).
+         */
+        [[nodiscard]] std::vector<double> point(std::uint32_t index) const;
+
+        /**
+         * Returns the number of the coordinates of each point.
+         */
+        [[nodiscard]] int dimensions() const;
+
+        static constexpr int MAX_DIMENSIONS = 10;
+
+    private:
+        static constexpr int NUM_BITS = 32;
+
+        int dimensions_;
+        /* for each coordinate, the scrambled direction numbers, i.e., the image of each direction number through the
+         * scrambling matrix */
+        std::vector<std::uint32_t> directions_;
+        std::vector<std::uint32_t> shifts_; // the digital shift of each coordinate
+    };
+
+}
+
+#endif //M6SS_SOBOLSEQUENCE_H
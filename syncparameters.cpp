@@ -16,6 +16,7 @@
  */
 #include <stdexcept>
 #include <numeric>
+#include <cstring>
 #include "syncparameters.h"
 
 using namespace std::chrono_literals;
@@ -119,3 +120,42 @@ const std::chrono::nanoseconds &M6SS::SyncParameters::getTSwitch() const {
 const std::chrono::nanoseconds &M6SS::SyncParameters::getTeb() const {
     return tEB_;
 }
+
+std::uint64_t M6SS::SyncParameters::hash() const {
+    auto mix = [](std::uint64_t h, std::uint64_t value) { // the finalizer of splitmix64 applied to h combined with value
+        std::uint64_t z = h ^ (value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    };
+
+    auto bits = [](double value) {
+        value += 0.0; // -0.0 becomes +0.0, since the two are equal
+        std::uint64_t result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    };
+
+    std::uint64_t h = mix(0, chs_.size());
+    for (int channel: chs_) {
+        h = mix(h, channel);
+    }
+    h = mix(h, s_);
+    h = mix(h, bits(pEB_));
+    for (int channel: chs_) { // pSR contains exactly the channels of chs
+        h = mix(h, bits(pSR_.at(channel)));
+    }
+    h = mix(h, tScan_.count());
+    h = mix(h, tSwitch_.count());
+    h = mix(h, tEB_.count());
+    return h;
+}
+
+bool M6SS::SyncParameters::operator==(const SyncParameters &other) const {
+    return chs_ == other.chs_ and s_ == other.s_ and pEB_ == other.pEB_ and pSR_ == other.pSR_ and
+           tScan_ == other.tScan_ and tSwitch_ == other.tSwitch_ and tEB_ == other.tEB_;
+}
+
+bool M6SS::SyncParameters::operator!=(const SyncParameters &other) const {
+    return !(*this == other);
+}
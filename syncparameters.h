@@ -21,6 +21,8 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <cstdint>
+#include <functional>
 
 namespace M6SS {
 
@@ -100,6 +102,22 @@ namespace M6SS {
          */
         [[nodiscard]] const std::chrono::nanoseconds &getTeb() const;
 
+        /**
+         * Returns a canonical hash of the parameters, which covers the channel hopping sequence (including the order of
+         * the channels), the number of slots, Peb, the Psr of each channel and the times. Equal parameters (see
+         * operator==) have equal hashes. The hash does not depend on the process that computes it (given the IEEE 754
+         * representation of doubles), so it can be used as a persistent key.
+         * @return a 64-bit hash of the parameters.
+         */
+        [[nodiscard]] std::uint64_t hash() const;
+
+        /**
+         * Checks if two instances represent the same synchronization parameters.
+         */
+        bool operator==(const SyncParameters &other) const;
+
+        bool operator!=(const SyncParameters &other) const;
+
         /**
          * The default duration of a timeslot in the 2.4Ghz band.
          */
@@ -174,4 +192,16 @@ namespace M6SS {
     };
 
 }
+
+namespace std {
+
+    template<>
+    struct hash<M6SS::SyncParameters> {
+        size_t operator()(const M6SS::SyncParameters &syncParameters) const {
+            return syncParameters.hash();
+        }
+    };
+
+}
+
 #endif //M6SS_SYNCPARAMETERS_H
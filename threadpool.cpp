@@ -0,0 +1,143 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "threadpool.h"
+
+M6SS::ThreadPool::ThreadPool(int numThreads) {
+    if (numThreads < 1) {
+        throw std::invalid_argument("numThreads must be greater than zero.");
+    }
+
+    workers_.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        workers_.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+M6SS::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+
+    for (auto &worker: workers_) {
+        worker.join();
+    }
+}
+
+M6SS::ThreadPool &M6SS::ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+int M6SS::ThreadPool::size() const {
+    return workers_.size();
+}
+
+void M6SS::ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    condition_.notify_one();
+}
+
+void M6SS::ThreadPool::parallelFor(size_t numTasks, const std::function<void(size_t)> &task) {
+    if (numTasks == 0) {
+        return;
+    }
+
+    // The state is shared with the helpers, since a helper may start after the call has returned (e.g., when all the
+    // workers were busy and the calling thread executed all the tasks).
+    struct State {
+        explicit State(const std::function<void(size_t)> &task) : task(task) {}
+
+        const std::function<void(size_t)> &task;
+        std::atomic<size_t> next{0};
+        size_t completed = 0;
+        size_t numTasks = 0;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool done = false;
+    };
+
+    auto state = std::make_shared<State>(task);
+    state->numTasks = numTasks;
+
+    auto drain = [](const std::shared_ptr<State> &state) {
+        size_t i;
+        size_t executed = 0;
+        while ((i = state->next.fetch_add(1)) < state->numTasks) {
+            try {
+                state->task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(state->mutex);
+                if (!state->exception) {
+                    state->exception = std::current_exception();
+                }
+                // skip the indices that have not been handed out yet
+                size_t skipped = state->numTasks - std::min(state->numTasks, state->next.exchange(state->numTasks));
+                state->completed += skipped;
+            }
+            executed++;
+        }
+
+        if (executed > 0) {
+            std::lock_guard<std::mutex> guard(state->mutex);
+            state->completed += executed;
+            if (state->completed == state->numTasks) {
+                state->done = true;
+                state->condition.notify_all();
+            }
+        }
+    };
+
+    size_t numHelpers = std::min(numTasks - 1, workers_.size());
+    for (size_t h = 0; h < numHelpers; h++) {
+        submit([state, drain]() { drain(state); });
+    }
+
+    drain(state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&state]() { return state->done; });
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+void M6SS::ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ or !tasks_.empty(); });
+            if (tasks_.empty()) { // stopping
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_THREADPOOL_H
+#define M6SS_THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace M6SS {
+
+    /**
+     * This class represents a fixed set of worker threads that execute tasks.
+     */
+    class ThreadPool {
+    public:
+        /**
+         * Initializes a new instance of the ThreadPool class.
+         * @param numThreads the number of worker threads.
+         * @throw std::invalid_argument if numThreads is less than 1.
+         */
+        explicit ThreadPool(int numThreads);
+
+        /**
+         * Waits for the submitted tasks to finish and stops the worker threads.
+         */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+         * Returns a pool that is shared by the whole program, with a worker thread for each hardware thread.
+         */
+        static ThreadPool &shared();
+
+        /**
+         * Returns the number of worker threads.
+         */
+        [[nodiscard]] int size() const;
+
+        /**
+         * Submits a task for execution by a worker thread.
+         * @param task the task to execute.
+         */
+        void submit(std::function<void()> task);
+
+        /**
+         * Executes task(i) for each i in [0, numTasks) and waits for all of them to finish. The indices are handed out
+         * one at a time to the worker threads, as well as to the calling thread, as soon as they become idle, so that
+         * the load is balanced even when the cost of the tasks varies a lot. It is noted that the function may be
+         * called from a task of the pool.
+         * @param numTasks the number of tasks.
+         * @param task the function to execute for each index.
+         * @throw any exception thrown by a task; in this case, the indices that have not been handed out yet are
+         * skipped.
+         */
+        void parallelFor(size_t numTasks, const std::function<void(size_t)> &task);
+
+    private:
+        void work();
+
+        std::vector<std::thread> workers_;
+        std::deque<std::function<void()> > tasks_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        bool stopping_ = false;
+    };
+
+}
+
+#endif //M6SS_THREADPOOL_H
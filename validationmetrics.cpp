@@ -0,0 +1,176 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#include <stdexcept>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include "validationmetrics.h"
+
+using std::chrono::nanoseconds, std::chrono::duration;
+
+M6SS::ValidationMetrics::ValidationMetrics(long numCases) : id_(nextId_.fetch_add(1, std::memory_order_relaxed)),
+                                                            numCases_(numCases),
+                                                            start_(std::chrono::steady_clock::now()),
+                                                            slots_(new Slot[MAX_THREADS]) {}
+
+void M6SS::ValidationMetrics::caseCompleted(int flow) {
+    slot().casesCompleted[flow - 1].fetch_add(1, std::memory_order_relaxed);
+}
+
+void M6SS::ValidationMetrics::simulation(long numRuns, nanoseconds duration) {
+    Slot &s = slot();
+    s.simulatorRuns.fetch_add(numRuns, std::memory_order_relaxed);
+    s.busyNanoseconds.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+void M6SS::ValidationMetrics::modelEvaluation(int caseType, nanoseconds duration) {
+    Slot &s = slot();
+    s.modelEvaluations[caseType - 1].fetch_add(1, std::memory_order_relaxed);
+    s.modelNanoseconds[caseType - 1].fetch_add(duration.count(), std::memory_order_relaxed);
+    s.busyNanoseconds.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+void M6SS::ValidationMetrics::recordQueued() {
+    slot().recordsQueued.fetch_add(1, std::memory_order_relaxed);
+}
+
+void M6SS::ValidationMetrics::databaseWrite(long numRecords, nanoseconds latency) {
+    Slot &s = slot();
+    s.recordsWritten.fetch_add(numRecords, std::memory_order_relaxed);
+    s.databaseWrites.fetch_add(1, std::memory_order_relaxed);
+    s.databaseNanoseconds.fetch_add(latency.count(), std::memory_order_relaxed);
+
+    std::uint64_t max = s.maxDatabaseNanoseconds.load(std::memory_order_relaxed);
+    while (static_cast<std::uint64_t>(latency.count()) > max and
+           not s.maxDatabaseNanoseconds.compare_exchange_weak(max, latency.count(), std::memory_order_relaxed));
+}
+
+M6SS::ValidationMetrics::Slot &M6SS::ValidationMetrics::slot() {
+    // the slot of the thread in the last metrics that it has reported to (identified by their id, since other metrics
+    // may later be constructed at the same address)
+    thread_local std::uint64_t ownerId = 0;
+    thread_local Slot *threadSlot = nullptr;
+
+    if (ownerId != id_) {
+        ownerId = id_;
+        threadSlot = &slots_[numSlots_.fetch_add(1, std::memory_order_relaxed) % MAX_THREADS];
+    }
+    return *threadSlot;
+}
+
+std::string M6SS::ValidationMetrics::toJSON() const {
+    const double elapsed = duration<double>(std::chrono::steady_clock::now() - start_).count();
+    const int numSlots = std::min(numSlots_.load(std::memory_order_relaxed), MAX_THREADS);
+
+    auto sum = [this, numSlots](std::atomic<std::uint64_t> Slot::*counter) {
+        std::uint64_t total = 0;
+        for (int i = 0; i < numSlots; i++) {
+            total += (slots_[i].*counter).load(std::memory_order_relaxed);
+        }
+        return total;
+    };
+
+    std::uint64_t casesCompleted[NUM_CASE_TYPES] = {}, modelEvaluations[NUM_CASE_TYPES] = {},
+            modelNanoseconds[NUM_CASE_TYPES] = {}, totalCasesCompleted = 0, maxDatabaseNanoseconds = 0;
+    for (int i = 0; i < numSlots; i++) {
+        for (int type = 0; type < NUM_CASE_TYPES; type++) {
+            casesCompleted[type] += slots_[i].casesCompleted[type].load(std::memory_order_relaxed);
+            modelEvaluations[type] += slots_[i].modelEvaluations[type].load(std::memory_order_relaxed);
+            modelNanoseconds[type] += slots_[i].modelNanoseconds[type].load(std::memory_order_relaxed);
+        }
+        maxDatabaseNanoseconds = std::max(maxDatabaseNanoseconds,
+                                          slots_[i].maxDatabaseNanoseconds.load(std::memory_order_relaxed));
+    }
+    for (std::uint64_t cases: casesCompleted) {
+        totalCasesCompleted += cases;
+    }
+
+    const std::uint64_t recordsQueued = sum(&Slot::recordsQueued), recordsWritten = sum(&Slot::recordsWritten);
+    const std::uint64_t databaseWrites = sum(&Slot::databaseWrites);
+    const double casesPerSecond = elapsed > 0 ? totalCasesCompleted / elapsed : 0;
+    const long casesRemaining = std::max(0L, numCases_ - static_cast<long>(totalCasesCompleted));
+
+    std::ostringstream json;
+    auto array = [&json](const std::uint64_t *values, auto value) {
+        json << "[";
+        for (int type = 0; type < NUM_CASE_TYPES; type++) {
+            json << (type > 0 ? ", " : "") << value(values, type);
+        }
+        json << "]";
+    };
+
+    json << "{\n";
+    json << "  \"elapsedSeconds\": " << elapsed << ",\n";
+    json << "  \"casesCompleted\": " << totalCasesCompleted << ",\n";
+    json << "  \"casesCompletedPerFlow\": ";
+    array(casesCompleted, [](const std::uint64_t *values, int type) { return values[type]; });
+    json << ",\n";
+    json << "  \"casesRemaining\": " << casesRemaining << ",\n";
+    json << "  \"casesPerSecond\": " << casesPerSecond << ",\n";
+    json << "  \"etaSeconds\": ";
+    if (totalCasesCompleted > 0) {
+        json << casesRemaining / casesPerSecond;
+    } else {
+        json << "null";
+    }
+    json << ",\n";
+    json << "  \"simulatorRunsPerSecond\": " << (elapsed > 0 ? sum(&Slot::simulatorRuns) / elapsed : 0) << ",\n";
+    json << "  \"modelEvaluationsPerSecond\": ";
+    array(modelEvaluations, [elapsed](const std::uint64_t *values, int type) {
+        return elapsed > 0 ? values[type] / elapsed : 0;
+    });
+    json << ",\n";
+    json << "  \"modelSecondsPerEvaluation\": ";
+    array(modelEvaluations, [&modelNanoseconds](const std::uint64_t *values, int type) {
+        return values[type] > 0 ? modelNanoseconds[type] * 1e-9 / values[type] : 0;
+    });
+    json << ",\n";
+    json << "  \"queueDepth\": " << (recordsQueued > recordsWritten ? recordsQueued - recordsWritten : 0) << ",\n";
+    json << "  \"databaseWrites\": " << databaseWrites << ",\n";
+    json << "  \"databaseWriteSecondsMean\": "
+         << (databaseWrites > 0 ? sum(&Slot::databaseNanoseconds) * 1e-9 / databaseWrites : 0) << ",\n";
+    json << "  \"databaseWriteSecondsMax\": " << maxDatabaseNanoseconds * 1e-9 << ",\n";
+    json << "  \"threads\": [";
+    for (int i = 0; i < numSlots; i++) {
+        const Slot &s = slots_[i];
+        std::uint64_t evaluations = 0;
+        for (const std::atomic<std::uint64_t> &count: s.modelEvaluations) {
+            evaluations += count.load(std::memory_order_relaxed);
+        }
+        json << (i > 0 ? "," : "") << "\n    {\"simulatorRuns\": " << s.simulatorRuns.load(std::memory_order_relaxed)
+             << ", \"modelEvaluations\": " << evaluations
+             << ", \"busySeconds\": " << s.busyNanoseconds.load(std::memory_order_relaxed) * 1e-9 << "}";
+    }
+    json << "\n  ]\n";
+    json << "}\n";
+    return json.str();
+}
+
+void M6SS::ValidationMetrics::writeFile(const std::string &path) const {
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        file << toJSON();
+        if (not file) {
+            throw std::runtime_error("Fail to write the metrics to " + temporaryPath + ".");
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Fail to replace " + path + ".");
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ * Copyright 2020-2021 Apostolos Karalis
+ * This file is part of Minimal 6TiSCH Synchronization Simulator (M6SS).
+ *
+ * M6SS is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * M6SS is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with M6SS.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ * @author Apostolos Karalis <akaralis@unipi.gr>
+ */
+#ifndef M6SS_VALIDATIONMETRICS_H
+#define M6SS_VALIDATIONMETRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <memory>
+
+namespace M6SS {
+
+    /**
+     * This class collects the metrics of the throughput and the progress of a validation of the model (see
+     * ModelValidator::makeValidation): the cases completed, the runs of the simulator, the evaluations of the model for
+     * each of its cases (1, 2 and 3), the depth of the queue of the records that wait to be saved and the latency of
+     * the writes to the database.
+     *
+     * Each thread that reports an event counts it in its own slot (a cache line of relaxed atomic counters), so the
+     * threads never contend with each other; the slots are summed only when the metrics are written (see toJSON).
+     */
+    class ValidationMetrics {
+    public:
+        /**
+         * Initializes the metrics of a validation.
+         * @param numCases the number of the cases of the validation that have not been completed yet; it is used to
+         * estimate the time until the validation finishes.
+         */
+        explicit ValidationMetrics(long numCases);
+
+        /**
+         * Counts a case that has been completed.
+         * @param flow the flow of the case, in the range [1, NUM_CASE_TYPES].
+         */
+        void caseCompleted(int flow);
+
+        /**
+         * Counts the runs of a simulation.
+         * @param numRuns the number of the runs.
+         * @param duration the duration of the simulation.
+         */
+        void simulation(long numRuns, std::chrono::nanoseconds duration);
+
+        /**
+         * Counts an evaluation of the model.
+         * @param caseType the case of the model (see Model), in the range [1, NUM_CASE_TYPES].
+         * @param duration the duration of the evaluation.
+         */
+        void modelEvaluation(int caseType, std::chrono::nanoseconds duration);
+
+        /**
+         * Counts a record that has been pushed to the queue of the database.
+         */
+        void recordQueued();
+
+        /**
+         * Counts a write to the database.
+         * @param numRecords the number of the records that were saved by the write (zero for a commit).
+         * @param latency the duration of the write.
+         */
+        void databaseWrite(long numRecords, std::chrono::nanoseconds latency);
+
+        /**
+         * Returns the metrics as a JSON object. The rates are averages since the construction of the metrics, and the
+         * estimated time until the validation finishes (etaSeconds) assumes that the remaining cases are completed at
+         * the same rate (it is null until a case has been completed). The metrics of each thread (e.g., its busy
+         * seconds) are also given, so that the threads that fall behind can be spotted.
+         */
+        [[nodiscard]] std::string toJSON() const;
+
+        /**
+         * Writes the metrics (see toJSON) to a file, which is replaced atomically, so that it is never read half
+         * written.
+         * @param path the path of the file.
+         * @throw std::runtime_error if the file cannot be written.
+         */
+        void writeFile(const std::string &path) const;
+
+        static constexpr int NUM_CASE_TYPES = 3;
+
+        /* the number of the slots; the threads beyond this number share the slots */
+        static constexpr int MAX_THREADS = 256;
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> casesCompleted[NUM_CASE_TYPES] = {};
+            std::atomic<std::uint64_t> simulatorRuns = 0;
+            std::atomic<std::uint64_t> modelEvaluations[NUM_CASE_TYPES] = {};
+            std::atomic<std::uint64_t> modelNanoseconds[NUM_CASE_TYPES] = {};
+            std::atomic<std::uint64_t> busyNanoseconds = 0; // of the simulations and the evaluations of the model
+            std::atomic<std::uint64_t> recordsQueued = 0;
+            std::atomic<std::uint64_t> recordsWritten = 0;
+            std::atomic<std::uint64_t> databaseWrites = 0;
+            std::atomic<std::uint64_t> databaseNanoseconds = 0;
+            std::atomic<std::uint64_t> maxDatabaseNanoseconds = 0;
+        };
+
+        /* Returns the slot of the calling thread, which is claimed on its first event. */
+        Slot &slot();
+
+        /* the id of the next metrics, which tells a thread whether its slot belongs to these metrics */
+        static inline std::atomic<std::uint64_t> nextId_ = 1;
+
+        const std::uint64_t id_;
+        const long numCases_;
+        const std::chrono::steady_clock::time_point start_;
+        std::unique_ptr<Slot[]> slots_;
+        std::atomic<int> numSlots_ = 0; // the number of the claimed slots
+    };
+
+}
+
+#endif //M6SS_VALIDATIONMETRICS_H